@@ -2,12 +2,29 @@
 #define GINSENG_GINSENG_HPP
 
 #include <algorithm>
-#include <bitset>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace ginseng {
 
@@ -31,9 +48,11 @@ struct index_of<T, U, Ts...> : std::integral_constant<std::size_t, 1 + index_of_
 
 using type_guid = std::size_t;
 
+/*! Returns a new guid, starting from 1. Safe to call from several threads at once.
+ */
 inline type_guid get_next_type_guid() noexcept {
-    static type_guid x = 0;
-    return ++x;
+    static std::atomic<type_guid> x{0};
+    return x.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
 template <typename T>
@@ -42,17 +61,74 @@ type_guid get_type_guid() {
     return my_guid;
 }
 
+/*! A database's own number for a component type, which is also the type's bit in the database's signatures.
+ *
+ * Slot 0 is never given to a component type.
+ */
+using type_slot = std::size_t;
+
+// Bit Operations
+
+/*! Index of the lowest set bit. The word must not be zero.
+ */
+inline int countr_zero(std::uint64_t word) noexcept {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+/*! Index of the highest set bit. The word must not be zero.
+ */
+inline int floor_log2(std::uint64_t word) noexcept {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(word);
+#endif
+}
+
+/*! Number of set bits.
+ */
+inline int popcount(std::uint64_t word) noexcept {
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(word));
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+// Query Guid
+
+using query_guid = std::size_t;
+
+/*! Returns a new guid, starting from 0. Safe to call from several threads at once.
+ */
+inline query_guid get_next_query_guid() noexcept {
+    static std::atomic<query_guid> x{0};
+    return x.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename... Coms>
+query_guid get_query_guid() {
+    static const query_guid my_guid = get_next_query_guid();
+    return my_guid;
+}
+
 // Dynamic Bitset
 
 class dynamic_bitset {
 public:
     using size_type = std::size_t;
+    using word_type = std::uint64_t;
 
     static constexpr size_type word_size = 64;
 
-    using bitset = std::bitset<word_size>;
-    using bitset_array = bitset*;
-
     dynamic_bitset()
         : sdo(0), numbits(word_size) {}
 
@@ -61,37 +137,33 @@ public:
 
     dynamic_bitset(dynamic_bitset&& other) {
         if (other.using_sdo()) {
-            new (&sdo) bitset(std::move(other.sdo));
+            sdo = other.sdo;
             numbits = other.numbits;
         } else {
             dyna = other.dyna;
             numbits = other.numbits;
             other.numbits = word_size;
-            new (&other.sdo) bitset(0);
+            other.sdo = 0;
         }
     }
 
     dynamic_bitset& operator=(dynamic_bitset&& other) {
-        if (using_sdo()) {
-            sdo.~bitset();
-        } else {
+        if (!using_sdo()) {
             delete[] dyna;
         }
         if (other.using_sdo()) {
-            new (&sdo) bitset(std::move(other.sdo));
+            sdo = other.sdo;
         } else {
             dyna = other.dyna;
         }
         numbits = other.numbits;
-        new (&other.sdo) bitset(0);
+        other.sdo = 0;
         other.numbits = word_size;
         return *this;
     }
 
     ~dynamic_bitset() {
-        if (using_sdo()) {
-            sdo.~bitset();
-        } else {
+        if (!using_sdo()) {
             delete[] dyna;
         }
     }
@@ -100,20 +172,25 @@ public:
         return numbits;
     }
 
+    size_type num_words() const {
+        return numbits / word_size;
+    }
+
     bool using_sdo() const {
         return numbits == word_size;
     }
 
+    const word_type* words() const {
+        return using_sdo() ? &sdo : dyna;
+    }
+
     void resize(size_type i) {
         if (i > numbits) {
             auto count = (i + word_size - 1) / word_size;
-            auto newptr = new bitset[count];
+            auto newptr = new word_type[count]();
             auto newlen = count * word_size;
-            auto bitarr = using_sdo() ? &sdo : dyna;
-            std::copy(bitarr, bitarr + (numbits / word_size), newptr);
-            if (using_sdo()) {
-                sdo.~bitset();
-            } else {
+            std::copy(words(), words() + num_words(), newptr);
+            if (!using_sdo()) {
                 delete[] dyna;
             }
             dyna = newptr;
@@ -121,48 +198,376 @@ public:
         }
     }
 
+    /*! Gets the `w`th word of bits. Words past the end are zero.
+     */
+    word_type get_word(size_type w) const {
+        if (w >= num_words()) return 0;
+        return words()[w];
+    }
+
     bool get(size_type i) const {
         if (i >= numbits) return false;
-        const auto& bits = using_sdo() ? sdo : dyna[i / word_size];
-        return bits[i % word_size];
+        return (words()[i / word_size] >> (i % word_size)) & 1;
     }
 
     void set(size_type i) {
-        if (using_sdo() && i < word_size) {
-            sdo[i] = true;
-        } else {
+        if (i >= numbits) {
             resize(i + 1);
-            auto& bits = using_sdo() ? sdo : dyna[i / word_size];
-            bits[i % word_size] = true;
         }
+        mutable_words()[i / word_size] |= word_type{1} << (i % word_size);
     }
 
     void unset(size_type i) {
         if (i < numbits) {
-            auto& bits = using_sdo() ? sdo : dyna[i / word_size];
-            bits[i % word_size] = false;
+            mutable_words()[i / word_size] &= ~(word_type{1} << (i % word_size));
         }
     }
 
     void zero() {
-        auto bitarr = using_sdo() ? &sdo : dyna;
-        std::fill(bitarr, bitarr + numbits / word_size, 0);
+        std::fill(mutable_words(), mutable_words() + num_words(), 0);
+    }
+
+    /*! Number of set bits.
+     */
+    size_type count() const {
+        auto total = size_type{0};
+        for (auto w = size_type{0}, n = num_words(); w < n; ++w) {
+            total += popcount(words()[w]);
+        }
+        return total;
+    }
+
+    /*! Index of the first set bit at or after `i`, or `size()` if there is none.
+     */
+    size_type find_next(size_type i) const {
+        if (i >= numbits) return numbits;
+        auto w = i / word_size;
+        auto word = words()[w] & (~word_type{0} << (i % word_size));
+        for (auto n = num_words();;) {
+            if (word != 0) {
+                return w * word_size + countr_zero(word);
+            }
+            if (++w == n) {
+                return numbits;
+            }
+            word = words()[w];
+        }
+    }
+
+    /*! Whether every bit that is set in `other` is also set in this.
+     */
+    bool contains_all(const dynamic_bitset& other) const {
+        auto n = std::min(num_words(), other.num_words());
+        auto a = words();
+        auto b = other.words();
+        auto missing = word_type{0};
+        for (auto w = size_type{0}; w < n; ++w) {
+            missing |= b[w] & ~a[w];
+        }
+        for (auto w = n, m = other.num_words(); w < m; ++w) {
+            missing |= b[w];
+        }
+        return missing == 0;
+    }
+
+    /*! Whether any bit is set in both this and `other`.
+     */
+    bool intersects(const dynamic_bitset& other) const {
+        auto n = std::min(num_words(), other.num_words());
+        auto a = words();
+        auto b = other.words();
+        auto common = word_type{0};
+        for (auto w = size_type{0}; w < n; ++w) {
+            common |= a[w] & b[w];
+        }
+        return common != 0;
     }
 
 private:
+    word_type* mutable_words() {
+        return using_sdo() ? &sdo : dyna;
+    }
+
     union {
-        bitset sdo;
-        bitset_array dyna;
+        word_type sdo;
+        word_type* dyna;
     };
     size_type numbits;
 };
 
-// Entity
+// Fixed Bitset
+
+/*! Bitset with a size fixed at compile time, which can be built in constant expressions.
+ */
+template <std::size_t Bits>
+struct fixed_bitset {
+    using size_type = std::size_t;
+    using word_type = std::uint64_t;
+
+    static constexpr size_type word_size = 64;
+    static constexpr size_type num_words = (Bits + word_size - 1) / word_size;
+
+    constexpr bool get(size_type i) const {
+        return (words[i / word_size] >> (i % word_size)) & 1;
+    }
+
+    constexpr void set(size_type i) {
+        words[i / word_size] |= word_type{1} << (i % word_size);
+    }
+
+    constexpr void unset(size_type i) {
+        words[i / word_size] &= ~(word_type{1} << (i % word_size));
+    }
+
+    /*! Whether every bit that is set in `other` is also set in this.
+     */
+    constexpr bool contains_all(const fixed_bitset& other) const {
+        auto missing = word_type{0};
+        for (auto w = size_type{0}; w < num_words; ++w) {
+            missing |= other.words[w] & ~words[w];
+        }
+        return missing == 0;
+    }
+
+    /*! Whether any bit is set in both this and `other`.
+     */
+    constexpr bool intersects(const fixed_bitset& other) const {
+        auto common = word_type{0};
+        for (auto w = size_type{0}; w < num_words; ++w) {
+            common |= words[w] & other.words[w];
+        }
+        return common != 0;
+    }
+
+    word_type words[num_words] = {};
+};
+
+// Signature Reference
+
+/*! Read-only view of an entity's component bits.
+ *
+ * The first word, which also holds the "alive" bit, is stored separately from the overflow words
+ * that hold the bits for type guids of 64 or more.
+ */
+class signature_ref {
+public:
+    using size_type = std::size_t;
+    using word_type = dynamic_bitset::word_type;
+
+    static constexpr size_type word_size = dynamic_bitset::word_size;
+
+    signature_ref(word_type first, const word_type* overflow, size_type num_overflow)
+        : first(first), overflow(overflow), num_overflow(num_overflow) {}
+
+    /*! Gets the `w`th word of bits. Words past the end are zero.
+     */
+    word_type get_word(size_type w) const {
+        if (w == 0) {
+            return first;
+        }
+        return w - 1 < num_overflow ? overflow[w - 1] : 0;
+    }
+
+    bool get(size_type i) const {
+        return (get_word(i / word_size) >> (i % word_size)) & 1;
+    }
+
+private:
+    word_type first;
+    const word_type* overflow;
+    size_type num_overflow;
+};
+
+// Thread Pool
+
+/*! Identifies the pool worker running on the current thread, and the task it is running.
+ *
+ * The thread that calls `thread_pool::run()` is worker 0.
+ *
+ * `pass` numbers the calls to `thread_pool::run()` across all pools, so it increases from one call to the next.
+ * After a call, the calling thread's task is the number of tasks that the call ran,
+ * so that `(pass, task)` orders everything the thread does after the call behind the call's tasks.
+ */
+struct worker_context {
+    std::size_t worker = 0;
+    std::size_t pass = 0;
+    std::size_t task = 0;
+};
+
+inline thread_local worker_context this_worker = {};
+
+inline std::size_t get_next_pass() noexcept {
+    static std::atomic<std::size_t> x{0};
+    return x.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+/*! Number of threads, including the calling thread, that a thread pool should use by default.
+ */
+inline std::size_t default_concurrency() {
+    return std::max(std::size_t{std::thread::hardware_concurrency()}, std::size_t{1});
+}
+
+class thread_pool {
+public:
+    explicit thread_pool(std::size_t num_workers) {
+        workers.reserve(num_workers);
+        for (auto i = std::size_t{0}; i < num_workers; ++i) {
+            workers.emplace_back([this, i] {
+                this_worker.worker = i + 1;
+                work();
+            });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /*! Number of threads that execute tasks, including the calling thread.
+     */
+    std::size_t concurrency() const {
+        return workers.size() + 1;
+    }
+
+    /*! Runs `task(i)` for every `i` in `[0, num_tasks)` and blocks until all of them are done.
+     *
+     * Tasks are handed out dynamically, and the calling thread participates.
+     *
+     * If a task throws, tasks that have not started yet are skipped,
+     * and the first exception is rethrown on the calling thread once every task has finished or been skipped.
+     */
+    template <typename Task>
+    void run(std::size_t num_tasks, Task&& task) {
+        if (num_tasks == 0) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        // Workers that woke up late for a previous job must leave before the counters are reset.
+        done.wait(lock, [&] { return active_workers == 0; });
+
+        job = [&task](std::size_t i) { task(i); };
+        job_pass = get_next_pass();
+        job_size = num_tasks;
+        next_task = 0;
+        done_tasks = 0;
+        ++generation;
+
+        lock.unlock();
+        wake.notify_all();
+
+        drain();
+
+        lock.lock();
+        done.wait(lock, [&] { return done_tasks == job_size && active_workers == 0; });
+        job = nullptr;
+        this_worker.pass = job_pass;
+        this_worker.task = job_size;
+
+        if (auto e = std::exchange(error, nullptr)) {
+            failed = false;
+            lock.unlock();
+            std::rethrow_exception(e);
+        }
+    }
+
+private:
+    void work() {
+        auto seen = std::size_t{0};
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                ++active_workers;
+            }
+
+            drain();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --active_workers;
+            }
+            done.notify_all();
+        }
+    }
+
+    void drain() {
+        for (;;) {
+            auto i = next_task.fetch_add(1);
+            if (i >= job_size) {
+                return;
+            }
+            this_worker.pass = job_pass;
+            this_worker.task = i;
+            if (!failed) {
+                try {
+                    job(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed = true;
+                }
+            }
+            if (done_tasks.fetch_add(1) + 1 == job_size) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(std::size_t)> job;
+    std::size_t job_pass = 0;
+    std::size_t job_size = 0;
+    std::size_t generation = 0;
+    std::size_t active_workers = 0;
+    std::atomic<std::size_t> next_task = 0;
+    std::atomic<std::size_t> done_tasks = 0;
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+    bool stopping = false;
+};
+
+// Database Configuration
 
-struct entity {
+/*! Default database configuration.
+ *
+ * Entity indices and versions are `std::size_t`.
+ */
+struct default_config {
+    using index_type = std::size_t;
     using version_type = std::size_t;
-    dynamic_bitset components = {};
-    version_type version = 0;
+};
+
+/*! Compact database configuration.
+ *
+ * Entity indices and versions are 32 bits, so an `ent_id` fits in 64 bits
+ * and the maps between entities and components use half the memory.
+ * A database with this configuration holds at most 2^32 - 1 entities.
+ */
+struct compact_config {
+    using index_type = std::uint32_t;
+    using version_type = std::uint32_t;
 };
 
 // False Type
@@ -250,6 +655,62 @@ private:
     bool tag;
 };
 
+/*! Span
+ *
+ * A contiguous run of components, passed to `visit_chunks` visitors. Works like C++20's `std::span`.
+ */
+template <typename T>
+class span {
+public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using size_type = std::size_t;
+    using iterator = T*;
+
+    constexpr span() noexcept = default;
+
+    constexpr span(T* data, size_type size) noexcept
+        : ptr(data), len(size) {}
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+    constexpr span(const span<U>& other) noexcept
+        : ptr(other.data()), len(other.size()) {}
+
+    constexpr T* data() const noexcept {
+        return ptr;
+    }
+
+    constexpr size_type size() const noexcept {
+        return len;
+    }
+
+    constexpr bool empty() const noexcept {
+        return len == 0;
+    }
+
+    constexpr T& operator[](size_type i) const {
+        return ptr[i];
+    }
+
+    constexpr iterator begin() const noexcept {
+        return ptr;
+    }
+
+    constexpr iterator end() const noexcept {
+        return ptr + len;
+    }
+
+private:
+    T* ptr = nullptr;
+    size_type len = 0;
+};
+
+template <typename T>
+class soa_ref;
+
+template <typename T>
+class soa_span;
+
 template <typename T>
 class optional<require<T>> {
 public:
@@ -281,6 +742,7 @@ struct meta {};
 struct optional : meta {};
 struct eid : meta {};
 struct inverted : noload {};
+struct proxy : positive {};
 
 } // namespace component_tags
 
@@ -316,436 +778,4547 @@ struct component_traits<DB, deny<Component>> {
     using component = Component;
 };
 
+template <typename DB, typename Component>
+struct component_traits<DB, soa_ref<Component>> {
+    using category = component_tags::proxy;
+    using component = Component;
+};
+
 template <typename DB>
 struct component_traits<DB, typename DB::ent_id> {
     using category = component_tags::eid;
     using component = void;
 };
 
-// First
+} // namespace _detail
 
-template <typename T, typename... Ts>
-struct first {
-    using type = T;
-};
+// Storage Traits
 
-template <typename... Ts>
-using first_t = typename first<Ts...>::type;
+namespace storage_policy {
 
-// Primary
+/*! Stable storage
+ *
+ * Components never move once added. Removed slots are recycled through a free list.
+ */
+struct stable {};
 
-template <typename T>
-struct primary {
-    using type = T;
+/*! Dense storage
+ *
+ * Components are kept packed. Removing a component moves the last component into its slot.
+ */
+struct dense {};
+
+/*! Field-split storage
+ *
+ * Each listed data member is stored in its own array, and components are kept packed like `dense`.
+ * For example, `soa<&particle::x, &particle::y>`.
+ *
+ * The component is never stored as a whole, so visitors must take `soa_ref<T>` instead of `T&`,
+ * and `get_component<T>()` returns a `soa_ref<T>`. Members that are not listed are not stored.
+ */
+template <auto... Fields>
+struct soa {};
+
+} // namespace storage_policy
+
+/*! Storage traits
+ *
+ * Specialize this for a component type to choose how it is stored.
+ *
+ * `policy` must be one of the types in `ginseng::storage_policy`.
+ *
+ * A specialization may also declare `static constexpr std::size_t bucket_size`, the number of components per
+ * storage bucket, which must be a power of two of at least 64. By default it is derived from `sizeof(Component)`.
+ */
+template <typename Component>
+struct storage_traits {
+    using policy = storage_policy::stable;
 };
 
-// GetPrimary
+namespace _detail {
 
-template <typename DB, typename... Components>
-struct get_primary;
+// Storage Policy
 
-template <typename DB, typename... Components>
-using get_primary_t = typename get_primary<DB, Components...>::type;
+// Tags have no storage of their own, regardless of storage_traits.
+struct tag_storage {};
 
-template <typename DB, typename HeadCom, typename... Components>
-struct get_primary<DB, HeadCom, Components...> {
-    using category = typename component_traits<DB, HeadCom>::category;
-    using type = std::conditional_t<std::is_same_v<category, component_tags::normal>, primary<HeadCom>, get_primary_t<DB, Components...>>;
+template <typename T>
+struct storage_policy_of {
+    using type = typename storage_traits<T>::policy;
 };
 
-template <typename DB>
-struct get_primary<DB> {
-    using type = primary<void>;
+template <typename T>
+struct storage_policy_of<tag<T>> {
+    using type = tag_storage;
 };
 
-// Database Traits
+template <typename T>
+using storage_policy_t = typename storage_policy_of<T>::type;
 
-template <typename DB>
-struct database_traits {
+// Field-Split Layout
 
-    using ent_id = typename DB::ent_id;
-    using com_id = typename DB::com_id;
+template <typename C, typename M>
+M field_member_of(M C::*);
 
-    template <typename C>
-    using component_traits = component_traits<DB, C>;
+template <auto Field>
+using field_t = decltype(field_member_of(Field));
 
-    template <typename... Components>
-    using get_primary_t = get_primary_t<DB, Components...>;
+template <auto Field>
+struct field_tag {};
 
-    // VisitorKey
+template <typename Policy>
+struct soa_layout;
 
-    template <typename Primary, typename... Coms>
-    class visitor_key;
+template <auto... Fields>
+struct soa_layout<storage_policy::soa<Fields...>> {
+    static_assert(sizeof...(Fields) > 0, "Field-split storage needs at least one field");
 
-    template <typename Primary, typename... Coms>
-    class visitor_key<primary<Primary>, Coms...> {
-    public:
-        template <typename Com>
-        using tag_t = typename component_traits<Com>::category;
+    // Pointers to the same element of every field array.
+    using pointers = std::tuple<field_t<Fields>*...>;
 
-        template <typename Com>
-        using com_t = typename component_traits<Com>::component;
+    template <auto Field>
+    static constexpr std::size_t index = index_of_v<field_tag<Field>, field_tag<Fields>...>;
 
-        bool check(DB& db, ent_id eid) const {
-            return (check<Coms>(db, eid, get_guid(index_of_v<com_t<Coms>, com_t<Coms>...>), tag_t<Coms>{}) && ...);
-        }
+    static pointers advance(const pointers& ptrs, std::size_t n) {
+        return std::apply([&](auto*... p) { return pointers{(p + n)...}; }, ptrs);
+    }
 
-        type_guid get_guid(std::size_t i) const {
-            if (i < sizeof...(Coms)) {
-                return guids[i];
-            } else {
-                return 0;
-            }
-        }
+    template <typename T>
+    static T load(const pointers& ptrs) {
+        auto com = T{};
+        ((com.*Fields = *std::get<index<Fields>>(ptrs)), ...);
+        return com;
+    }
 
-    private:
-        template <typename Com>
-        static bool check(DB& db, ent_id eid, type_guid guid, component_tags::positive) {
-            using component = typename component_traits<Com>::component;
-            if constexpr (std::is_same_v<Primary, component>) {
-                return true;
-            } else {
-                return db.template has_component<component>(eid, guid);
-            }
-        }
+    template <typename T>
+    static void store(const pointers& ptrs, const T& com) {
+        ((*std::get<index<Fields>>(ptrs) = com.*Fields), ...);
+    }
 
-        template <typename Com>
-        static bool check(DB& db, ent_id eid, type_guid guid, component_tags::inverted) {
-            using component = typename component_traits<Com>::component;
-            if constexpr (std::is_same_v<Primary, component>) {
-                return false;
-            } else {
-                return !db.template has_component<component>(eid, guid);
-            }
-        }
-
-        template <typename Com>
-        static bool check([[maybe_unused]] DB& db, [[maybe_unused]] ent_id eid, [[maybe_unused]] type_guid guid, component_tags::meta) {
-            return true;
-        }
-
-        type_guid guids[sizeof...(Coms)] = {get_type_guid<com_t<Coms>>()...};
-    };
+    template <typename T>
+    static void store(const pointers& ptrs, T&& com) {
+        ((*std::get<index<Fields>>(ptrs) = std::move(com.*Fields)), ...);
+    }
+};
 
-    // VisitorTraits
+/*! Reference to a field-split component
+ *
+ * Refers to one component whose fields are stored in separate arrays.
+ * Use `get<&T::field>()` to access a field, convert to `T` to load the whole component, or assign a `T` to store one.
+ *
+ * When used as a visitor parameter, matches like `T`.
+ */
+template <typename T>
+class soa_ref {
+public:
+    using layout = soa_layout<storage_policy_t<T>>;
+    using pointers = typename layout::pointers;
 
-    template <typename... Components>
-    struct visitor_traits_impl {
-        using ent_id = typename DB::ent_id;
-        using com_id = typename DB::com_id;
-        using primary_component = get_primary_t<Components...>;
+    explicit soa_ref(const pointers& ptrs)
+        : fields(ptrs) {}
 
-        template <typename Com>
-        using tag_t = typename component_traits<Com>::category;
+    soa_ref(const soa_ref&) = default;
 
-        template <typename Com>
-        using com_t = typename component_traits<Com>::component;
+    /*! Assigns the referenced component, not the reference.
+     */
+    const soa_ref& operator=(const soa_ref& other) const {
+        layout::store(fields, T(other));
+        return *this;
+    }
 
-        template <typename T>
-        type_guid get_guid() const {
-            return key.get_guid(index_of_v<com_t<T>, com_t<Components>...>);
-        }
+    const soa_ref& operator=(const T& com) const {
+        layout::store(fields, com);
+        return *this;
+    }
 
-        template <typename Visitor>
-        auto apply(DB& db, ent_id eid, com_id primary_cid, Visitor&& visitor) {
-            if (key.check(db, eid)) {
-                return std::forward<Visitor>(visitor)(get_com<Components>(tag_t<Components>{}, db, eid, primary_cid, get_guid<Components>(), primary_component{})...);
-            }
-        }
+    const soa_ref& operator=(T&& com) const {
+        layout::store(fields, std::move(com));
+        return *this;
+    }
 
-    private:
-        template <typename Com, typename Primary>
-        static Com& get_com(component_tags::normal, DB& db, const ent_id& eid, const com_id& primary_cid, type_guid guid, primary<Primary>) {
-            if constexpr (std::is_same_v<Com, Primary>) {
-                return db.template get_component_by_id<Com>(primary_cid, guid);
-            } else {
-                return db.template get_component<Com>(eid, guid);
-            }
-        }
+    template <auto Field>
+    field_t<Field>& get() const {
+        return *std::get<layout::template index<Field>>(fields);
+    }
 
-        template <typename Com, typename Primary>
-        static Com get_com(component_tags::optional, DB& db, const ent_id& eid, const com_id& primary_cid, type_guid guid, primary<Primary>) {
-            using traits = component_traits<Com>;
-            using inner_component = typename traits::component;
-            using inner_traits = component_traits<inner_component>;
-            using inner_category = typename inner_traits::category;
-            return get_com_optional<inner_component>(inner_category{}, db, eid, primary_cid, guid, primary<Primary>{});
-        }
+    operator T() const {
+        return layout::template load<T>(fields);
+    }
 
-        template <typename Com, typename Primary>
-        static optional<Com> get_com_optional(component_tags::normal, DB& db, const ent_id& eid, const com_id& primary_cid, type_guid guid, primary<Primary>) {
-            if constexpr (std::is_same_v<Com, Primary>) {
-                return db.template get_component_by_id<Com>(primary_cid, guid);
-            } else {
-                if (db.template has_component<Com>(eid)) {
-                    return optional<Com>(db.template get_component<Com>(eid, guid));
-                } else {
-                    return optional<Com>();
-                }
-            }
-        }
+private:
+    pointers fields;
+};
 
-        template <typename Com, typename Primary>
-        static optional<Com> get_com_optional(component_tags::tagged, DB& db, const ent_id& eid, [[maybe_unused]] const com_id& primary_cid, type_guid guid, primary<Primary>) {
-            return optional<Com>(db.template has_component<Com>(eid, guid));
-        }
+/*! Run of field-split components
+ *
+ * Passed to `visit_chunks` visitors. `data<&T::field>()` points to a contiguous array of that field.
+ */
+template <typename T>
+class soa_span {
+public:
+    using layout = soa_layout<storage_policy_t<T>>;
+    using pointers = typename layout::pointers;
+    using size_type = std::size_t;
 
-        template <typename Com, typename Primary>
-        static const ent_id& get_com(component_tags::eid, [[maybe_unused]] DB& db, const ent_id& eid, [[maybe_unused]] const com_id& primary_cid, [[maybe_unused]] type_guid guid, primary<Primary>) {
-            return eid;
-        }
+    soa_span(const pointers& ptrs, size_type size)
+        : fields(ptrs), len(size) {}
 
-        template <typename Com, typename Primary>
-        static Com get_com(component_tags::unit, [[maybe_unused]] DB& db, [[maybe_unused]] const ent_id& eid, [[maybe_unused]] const com_id& primary_cid, [[maybe_unused]] type_guid guid, primary<Primary>) {
-            return {};
-        }
+    template <auto Field>
+    field_t<Field>* data() const {
+        return std::get<layout::template index<Field>>(fields);
+    }
 
-        visitor_key<primary_component, Components...> key;
-    };
+    size_type size() const {
+        return len;
+    }
 
-    template <typename Visitor>
-    struct visitor_traits : visitor_traits<decltype(&std::decay_t<Visitor>::operator())> {};
+    bool empty() const {
+        return len == 0;
+    }
 
-    template <typename R, typename... Ts>
-    struct visitor_traits<R (&)(Ts...)> : visitor_traits_impl<std::decay_t<Ts>...> {};
+    soa_ref<T> operator[](size_type i) const {
+        return soa_ref<T>(layout::advance(fields, i));
+    }
 
-    template <typename Visitor, typename R, typename... Ts>
-    struct visitor_traits<R (Visitor::*)(Ts...)> : visitor_traits_impl<std::decay_t<Ts>...> {};
+private:
+    pointers fields;
+    size_type len;
+};
 
-    template <typename Visitor, typename R, typename... Ts>
-    struct visitor_traits<R (Visitor::*)(Ts...) const> : visitor_traits_impl<std::decay_t<Ts>...> {};
+/*! What `get_component<T>()` returns: `T&`, or `soa_ref<T>` for field-split components.
+ */
+template <typename T, typename Policy = storage_policy_t<T>>
+struct component_reference {
+    using type = T&;
+};
 
-    template <typename Visitor, typename R, typename... Ts>
-    struct visitor_traits<R (Visitor::*)(Ts...)&> : visitor_traits_impl<std::decay_t<Ts>...> {};
+template <typename T, auto... Fields>
+struct component_reference<T, storage_policy::soa<Fields...>> {
+    using type = soa_ref<T>;
+};
 
-    template <typename Visitor, typename R, typename... Ts>
-    struct visitor_traits<R (Visitor::*)(Ts...) const &> : visitor_traits_impl<std::decay_t<Ts>...> {};
+template <typename T>
+using component_reference_t = typename component_reference<T>::type;
 
-    template <typename Visitor, typename R, typename... Ts>
-    struct visitor_traits<R (Visitor::*)(Ts...) &&> : visitor_traits_impl<std::decay_t<Ts>...> {};
-};
+template <typename T>
+constexpr bool is_field_split_v = !std::is_same_v<component_reference_t<T>, T&>;
 
-// Component Set
+// Sparse Index
 
-class component_set {
+/*! Map from entity index to component ID.
+ *
+ * Stored in fixed-size pages which are allocated when first written,
+ * so memory grows with the entities that are mapped rather than with the largest entity index.
+ * Pages that have never been written all share one page of null IDs.
+ * Component IDs are stored as `Index`, which must be able to hold every component ID.
+ */
+template <typename Index = std::size_t>
+class sparse_index {
 public:
     using size_type = std::size_t;
-    virtual ~component_set() = 0;
-    virtual void remove(size_type entid) = 0;
+    using index_type = Index;
 
-    size_type get_count() const {
-        return count;
+    static constexpr size_type page_size = 4096;
+    static constexpr index_type null_id = static_cast<index_type>(-1);
+
+    sparse_index() = default;
+    sparse_index(const sparse_index&) = delete;
+    sparse_index& operator=(const sparse_index&) = delete;
+
+    sparse_index(sparse_index&& other) noexcept {
+        swap(other);
     }
 
-protected:
-    void set_count(size_type new_count) {
-        count = new_count;
+    sparse_index& operator=(sparse_index&& other) noexcept {
+        swap(other);
+        return *this;
     }
 
-private:
-    size_type count = 0;
-};
+    ~sparse_index() {
+        for (auto page : pages) {
+            release(page);
+        }
+    }
 
-inline component_set::~component_set() = default;
+    /*! Component ID of the entity, or `null_id` if it has none.
+     */
+    index_type get(size_type entid) const {
+        auto page = entid / page_size;
+        if (page >= pages.size()) {
+            return null_id;
+        }
+        return pages[page][entid % page_size];
+    }
 
-template <typename T>
-class component_set_impl final : public component_set {
-public:
-    virtual ~component_set_impl() override {
-        for (auto i = size_type{0}, sz = capacity(); i < sz; ++i) {
-            if (is_valid(i)) {
-                auto bucket = get_bucket_index(i);
-                auto rel_index = get_relative_index(i);
-                buckets[bucket][rel_index].component.~T();
-            }
+    void set(size_type entid, size_type comid) {
+        auto page = entid / page_size;
+        if (page >= pages.size()) {
+            pages.resize(page + 1, null_page());
         }
+        if (pages[page] == null_page()) {
+            pages[page] = new index_type[page_size];
+            std::fill(pages[page], pages[page] + page_size, null_id);
+        }
+        pages[page][entid % page_size] = static_cast<index_type>(comid);
     }
 
-    size_type assign(size_type entid, T com) {
-        if (entid >= entid_to_comid.size()) {
-            entid_to_comid.resize((entid + 1) * 3 / 2);
+    /*! Makes room in the page table for entities with indices below `num_entids`. Does not allocate pages.
+     */
+    void reserve(size_type num_entids) {
+        auto num_pages = (num_entids + page_size - 1) / page_size;
+        if (num_pages > pages.size()) {
+            pages.resize(num_pages, null_page());
+        }
+    }
+
+    /*! Releases every page past the one holding entity `num_entids - 1`.
+     */
+    void truncate(size_type num_entids) {
+        auto num_pages = (num_entids + page_size - 1) / page_size;
+        for (auto p = num_pages; p < pages.size(); ++p) {
+            release(pages[p]);
+        }
+        if (num_pages < pages.size()) {
+            pages.resize(num_pages);
         }
+        pages.shrink_to_fit();
+    }
 
-        auto index = free_head;
-        auto bucket = get_bucket_index(index);
-        auto rel_index = get_relative_index(index);
-        storage* slot;
+    void swap(sparse_index& other) noexcept {
+        pages.swap(other.pages);
+    }
 
-        if (index == back_index) {
-            if (bucket == buckets.size()) {
-                buckets.push_back(std::make_unique<storage[]>(bucket_size));
-                comid_to_entid.resize(comid_to_entid.size() + bucket_size, null_id);
-            }
+private:
+    static index_type* null_page() {
+        static auto page = [] {
+            auto ids = std::array<index_type, page_size>{};
+            ids.fill(null_id);
+            return ids;
+        }();
+        // Never written through: set() replaces the null page before writing.
+        return page.data();
+    }
 
-            slot = &buckets[bucket][rel_index];
-            ++back_index;
-            free_head = back_index;
-        } else {
-            slot = &buckets[bucket][rel_index];
-            free_head = slot->next_free;
+    static void release(index_type* page) {
+        if (page != null_page()) {
+            delete[] page;
         }
+    }
 
-        new (&slot->component) T(std::move(com));
-        entid_to_comid[entid] = index;
-        comid_to_entid[index] = entid;
+    std::vector<index_type*> pages;
+};
 
-        set_count(get_count() + 1);
+// Bucket Layout
 
-        return index;
+/*! Slots per bucket when `storage_traits` does not say: about 256 KiB, between 64 and 32768 slots.
+ */
+constexpr std::size_t default_bucket_size(std::size_t com_size) {
+    auto slots = std::size_t{4096 * 8};
+    while (slots > 64 && slots * com_size > 256 * 1024) {
+        slots /= 2;
     }
+    return slots;
+}
 
-    virtual void remove(size_type entid) override final {
-        auto index = entid_to_comid[entid];
-        auto bucket = get_bucket_index(index);
-        auto rel_index = get_relative_index(index);
-        auto& slot = buckets[bucket][rel_index];
+template <typename T, typename = void>
+struct bucket_size_of {
+    static constexpr std::size_t value = default_bucket_size(sizeof(T));
+};
 
-        slot.component.~T();
-        slot.next_free = free_head;
-        free_head = index;
-        comid_to_entid[index] = null_id;
+template <typename T>
+struct bucket_size_of<T, std::void_t<decltype(storage_traits<T>::bucket_size)>> {
+    static constexpr std::size_t value = storage_traits<T>::bucket_size;
+};
 
-        set_count(get_count() - 1);
+/*! Maps slot indices to buckets.
+ *
+ * Buckets start small and double until they reach the maximum size:
+ * `first_size, first_size, 2 * first_size, 4 * first_size, ..., max_size, max_size, ...`
+ *
+ * Every bucket starts on a multiple of 64, so per-slot bitmaps never straddle buckets.
+ */
+template <typename T>
+struct bucket_layout {
+    using size_type = std::size_t;
+
+    static constexpr size_type max_size = bucket_size_of<T>::value;
+    static constexpr size_type first_size = 64;
+
+    static_assert(max_size >= first_size && (max_size & (max_size - 1)) == 0, "Bucket size must be a power of two of at least 64");
+
+    static constexpr size_type log2(size_type x) {
+        auto r = size_type{0};
+        while (x > 1) {
+            x >>= 1;
+            ++r;
+        }
+        return r;
     }
 
-    bool is_valid(size_type comid) const {
-        return comid_to_entid[comid] != null_id;
+    // Buckets that together cover [0, max_size).
+    static constexpr size_type num_growing = log2(max_size) - log2(first_size) + 1;
+
+    static size_type bucket_index(size_type idx) {
+        if (idx < first_size) {
+            return 0;
+        } else if (idx < max_size) {
+            return floor_log2(idx) - log2(first_size) + 1;
+        } else {
+            return num_growing - 1 + idx / max_size;
+        }
     }
 
-    size_type get_comid(size_type entid) const {
-        return entid_to_comid[entid];
+    static size_type relative_index(size_type idx) {
+        if (idx < first_size) {
+            return idx;
+        } else if (idx < max_size) {
+            return idx - (size_type{1} << floor_log2(idx));
+        } else {
+            return idx % max_size;
+        }
     }
 
-    T& get_com(size_type comid) {
-        auto bucket = get_bucket_index(comid);
-        auto rel_index = get_relative_index(comid);
-        auto& slot = buckets[bucket][rel_index];
-        return slot.component;
+    static size_type bucket_begin(size_type bucket) {
+        if (bucket == 0) {
+            return 0;
+        } else if (bucket < num_growing) {
+            return first_size << (bucket - 1);
+        } else {
+            return (bucket - num_growing + 1) * max_size;
+        }
     }
 
-    size_type get_entid(size_type comid) const {
-        return comid_to_entid[comid];
+    static size_type bucket_capacity(size_type bucket) {
+        return bucket_begin(bucket + 1) - bucket_begin(bucket);
     }
 
-    size_type capacity() const {
-        return back_index;
+    /*! Number of buckets needed to hold `num_slots` slots.
+     */
+    static size_type buckets_for(size_type num_slots) {
+        return num_slots == 0 ? 0 : bucket_index(num_slots - 1) + 1;
     }
+};
 
-private:
-    union storage {
-        size_type next_free;
-        T component;
+// First
 
-        storage() {}
-        ~storage() {}
-    };
+template <typename T, typename... Ts>
+struct first {
+    using type = T;
+};
 
-    std::vector<size_type> entid_to_comid;
-    std::vector<size_type> comid_to_entid;
-    std::vector<std::unique_ptr<storage[]>> buckets;
-    size_type free_head = 0;
-    size_type back_index = 0;
+template <typename... Ts>
+using first_t = typename first<Ts...>::type;
 
-    static constexpr size_type bucket_size = 4096 * 8;
-    static constexpr size_type null_id = static_cast<size_type>(-1);
+// Primary
 
-    static size_type get_bucket_index(size_type idx) {
-        return idx / bucket_size;
-    }
+template <typename T>
+struct primary {
+    using type = T;
+};
 
-    static size_type get_relative_index(size_type idx) {
-        return idx % bucket_size;
-    }
+/*! Marks a visit over an owning group.
+ *
+ * Every owned component of the current entity has the same ComID as the primary one.
+ */
+template <typename... Owned>
+struct grouped {};
 
-    static size_type get_total_size(size_type num_buckets) {
-        return num_buckets * bucket_size;
-    }
+template <typename Com, typename Primary>
+struct shares_primary_cid : std::is_same<Com, Primary> {};
+
+template <typename Com, typename... Owned>
+struct shares_primary_cid<Com, grouped<Owned...>> : std::disjunction<std::is_same<Com, Owned>...> {};
+
+template <typename Com, typename Primary>
+constexpr bool shares_primary_cid_v = shares_primary_cid<Com, Primary>::value;
+
+// Primary Candidates
+
+template <typename DB, typename Component, typename Category = typename component_traits<DB, Component>::category>
+struct primary_candidate {
+    using type = std::tuple<>;
 };
 
-template <typename T>
-class component_set_impl<tag<T>> final : public component_set {
-public:
-    virtual ~component_set_impl() = default;
-    virtual void remove([[maybe_unused]] size_type entid) override final {}
+template <typename DB, typename Component>
+struct primary_candidate<DB, Component, component_tags::normal> {
+    using type = std::tuple<primary<typename component_traits<DB, Component>::component>>;
 };
 
-// Opaque index
+template <typename DB, typename Component>
+struct primary_candidate<DB, Component, component_tags::proxy> {
+    using type = std::tuple<primary<typename component_traits<DB, Component>::component>>;
+};
 
-template <typename Tag, typename Friend, typename Index>
-class opaque_index {
-public:
-    opaque_index() = default;
+template <typename DB, typename Component>
+struct primary_candidate<DB, Component, component_tags::noload> {
+    using type = std::tuple<primary<typename component_traits<DB, Component>::component>>;
+};
 
-    bool operator==(const opaque_index& other) {
-        return index == other.index;
-    }
+/*! Every component that could drive a visit, as a `std::tuple` of `primary<T>`.
+ *
+ * Only components that have storage and must be present on matching entities are candidates.
+ */
+template <typename DB, typename... Components>
+using primary_candidates_t = decltype(std::tuple_cat(std::declval<typename primary_candidate<DB, Components>::type>()...));
 
-    Index get_index() const {
-        return index;
-    }
+/*! The component type of the first candidate in a `std::tuple` of `primary<T>`, or `void` if there are none.
+ */
+template <typename Candidates>
+struct first_candidate {
+    using type = void;
+};
 
-private:
-    friend Friend;
+template <typename Com, typename... Rest>
+struct first_candidate<std::tuple<primary<Com>, Rest...>> {
+    using type = Com;
+};
 
-    opaque_index(Index i)
-        : index(i) {}
+// Database Traits
+
+template <typename DB>
+struct database_traits {
+
+    using ent_id = typename DB::ent_id;
+    using com_id = typename DB::com_id;
+
+    template <typename C>
+    using component_traits = component_traits<DB, C>;
+
+    template <typename... Components>
+    using primary_candidates_t = primary_candidates_t<DB, Components...>;
+
+    /*! `deny<T>` or `require<T>` for a parameter that filters entities, or `void` for one that does not.
+     */
+    template <typename Com, typename Category = typename component_traits<Com>::category>
+    using filter_t = std::conditional_t<std::is_base_of_v<component_tags::inverted, Category>,
+        deny<typename component_traits<Com>::component>,
+        std::conditional_t<std::is_base_of_v<component_tags::positive, Category>, require<typename component_traits<Com>::component>, void>>;
+
+    /*! Whether every entity that matches the parameters `Coms` also passes the filter of parameter `Com`.
+     */
+    template <typename Com, typename... Coms>
+    static constexpr bool filter_implied_v = std::is_void_v<filter_t<Com>> || (std::is_same_v<filter_t<Com>, filter_t<Coms>> || ...);
+
+    // VisitorKey
+
+    template <typename... Coms>
+    class visitor_key {
+    public:
+        template <typename Com>
+        using tag_t = typename component_traits<Com>::category;
+
+        template <typename Com>
+        using com_t = typename component_traits<Com>::component;
+
+        /*! Uses the type guids as signature bits, as archetype signatures do.
+         */
+        visitor_key()
+            : slots{get_type_guid<com_t<Coms>>()...} {
+            add_masks();
+        }
+
+        /*! Uses the database's slots as signature bits.
+         *
+         * Every component type gets a slot, even one the database has not used yet,
+         * so the key stays correct if the type is first added while it is in use.
+         */
+        explicit visitor_key(DB& db)
+            : slots{param_slot<Coms>(db)...} {
+            add_masks();
+        }
+
+        /*! Checks the entity's signature against the required and denied masks, one word at a time.
+         */
+        bool check(DB& db, ent_id eid) const {
+            return matches(db.get_signature(eid));
+        }
+
+        /*! Checks a `dynamic_bitset` or `signature_ref`.
+         */
+        template <typename Signature>
+        bool matches(const Signature& signature) const {
+            for (auto i = std::size_t{0}; i < num_masks; ++i) {
+                const auto& mask = masks[i];
+                auto word = signature.get_word(mask.word);
+                if ((word & mask.required) != mask.required || (word & mask.denied) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        type_slot get_slot(std::size_t i) const {
+            if (i < sizeof...(Coms)) {
+                return slots[i];
+            } else {
+                return 0;
+            }
+        }
+
+    private:
+        using word_type = dynamic_bitset::word_type;
+
+        template <typename Com>
+        static type_slot param_slot([[maybe_unused]] DB& db) {
+            if constexpr (std::is_same_v<tag_t<Com>, component_tags::eid>) {
+                return 0;
+            } else {
+                return db.template get_or_add_slot<com_t<Com>>();
+            }
+        }
+
+        struct signature_mask {
+            std::size_t word = 0;
+            word_type required = 0;
+            word_type denied = 0;
+        };
+
+        void add_masks() {
+            (add_mask(slots[index_of_v<com_t<Coms>, com_t<Coms>...>], tag_t<Coms>{}), ...);
+        }
+
+        signature_mask& get_mask(type_slot slot) {
+            auto word = slot / dynamic_bitset::word_size;
+            for (auto i = std::size_t{0}; i < num_masks; ++i) {
+                if (masks[i].word == word) {
+                    return masks[i];
+                }
+            }
+            auto& mask = masks[num_masks++];
+            mask.word = word;
+            return mask;
+        }
+
+        void add_mask(type_slot slot, component_tags::positive) {
+            get_mask(slot).required |= word_type{1} << (slot % dynamic_bitset::word_size);
+        }
+
+        void add_mask(type_slot slot, component_tags::inverted) {
+            get_mask(slot).denied |= word_type{1} << (slot % dynamic_bitset::word_size);
+        }
+
+        void add_mask([[maybe_unused]] type_slot slot, component_tags::meta) {}
+
+        type_slot slots[sizeof...(Coms)];
+        signature_mask masks[sizeof...(Coms)] = {};
+        std::size_t num_masks = 0;
+    };
+
+    // VisitorTraits
+
+    template <typename... Components>
+    struct visitor_traits_impl {
+        using ent_id = typename DB::ent_id;
+        using com_id = typename DB::com_id;
+        using primary_candidates = primary_candidates_t<Components...>;
+
+        /*! `Template<Components...>`, for visiting with storage other than the Database's own.
+         */
+        template <template <typename...> class Template>
+        using rebind_t = Template<Components...>;
+
+        template <typename Com>
+        using tag_t = typename component_traits<Com>::category;
+
+        template <typename Com>
+        using com_t = typename component_traits<Com>::component;
+
+        visitor_traits_impl() = default;
+
+        explicit visitor_traits_impl(DB& db)
+            : key(db) {}
+
+        template <typename T>
+        type_slot get_slot() const {
+            return key.get_slot(index_of_v<com_t<T>, com_t<Components>...>);
+        }
+
+        /*! Whether every entity that matches the parameters `Coms` also matches these parameters.
+         */
+        template <typename... Coms>
+        static constexpr bool implied_by_v = (filter_implied_v<Components, Coms...> && ...);
+
+        template <typename Visitor, typename Primary>
+        auto apply(DB& db, ent_id eid, com_id primary_cid, Visitor&& visitor, primary<Primary> prim) {
+            if (key.check(db, eid)) {
+                return apply_matched(db, eid, primary_cid, std::forward<Visitor>(visitor), prim);
+            }
+        }
+
+        /*! Like `apply()`, for an entity that is already known to match.
+         */
+        template <typename Visitor, typename Primary>
+        auto apply_matched(DB& db, ent_id eid, com_id primary_cid, Visitor&& visitor, primary<Primary> prim) {
+            return std::forward<Visitor>(visitor)(get_com<Components>(tag_t<Components>{}, db, eid, primary_cid, get_slot<Components>(), prim)...);
+        }
+
+    private:
+        template <typename Com, typename Primary>
+        static Com& get_com(component_tags::normal, DB& db, const ent_id& eid, const com_id& primary_cid, type_slot slot, primary<Primary>) {
+            static_assert(!is_field_split_v<Com>, "Field-split components must be visited as soa_ref<T>");
+            if constexpr (shares_primary_cid_v<Com, Primary>) {
+                return db.template get_component_by_id<Com>(primary_cid, slot);
+            } else {
+                return db.template get_component<Com>(eid, slot);
+            }
+        }
+
+        template <typename Com, typename Primary>
+        static Com get_com(component_tags::proxy, DB& db, const ent_id& eid, const com_id& primary_cid, type_slot slot, primary<Primary>) {
+            using component_t = com_t<Com>;
+            static_assert(is_field_split_v<component_t>, "soa_ref<T> requires T to use storage_policy::soa");
+            if constexpr (shares_primary_cid_v<component_t, Primary>) {
+                return db.template get_component_by_id<component_t>(primary_cid, slot);
+            } else {
+                return db.template get_component<component_t>(eid, slot);
+            }
+        }
+
+        template <typename Com, typename Primary>
+        static Com get_com(component_tags::optional, DB& db, const ent_id& eid, const com_id& primary_cid, type_slot slot, primary<Primary>) {
+            using traits = component_traits<Com>;
+            using inner_component = typename traits::component;
+            using inner_traits = component_traits<inner_component>;
+            using inner_category = typename inner_traits::category;
+            return get_com_optional<inner_component>(inner_category{}, db, eid, primary_cid, slot, primary<Primary>{});
+        }
+
+        template <typename Com, typename Primary>
+        static optional<Com> get_com_optional(component_tags::normal, DB& db, const ent_id& eid, const com_id& primary_cid, type_slot slot, primary<Primary>) {
+            if constexpr (shares_primary_cid_v<Com, Primary>) {
+                return db.template get_component_by_id<Com>(primary_cid, slot);
+            } else {
+                if (db.template has_component<Com>(eid, slot)) {
+                    return optional<Com>(db.template get_component<Com>(eid, slot));
+                } else {
+                    return optional<Com>();
+                }
+            }
+        }
+
+        template <typename Com, typename Primary>
+        static optional<Com> get_com_optional(component_tags::tagged, DB& db, const ent_id& eid, [[maybe_unused]] const com_id& primary_cid, type_slot slot, primary<Primary>) {
+            return optional<Com>(db.template has_component<Com>(eid, slot));
+        }
+
+        template <typename Com, typename Primary>
+        static const ent_id& get_com(component_tags::eid, [[maybe_unused]] DB& db, const ent_id& eid, [[maybe_unused]] const com_id& primary_cid, [[maybe_unused]] type_slot slot, primary<Primary>) {
+            return eid;
+        }
+
+        template <typename Com, typename Primary>
+        static Com get_com(component_tags::unit, [[maybe_unused]] DB& db, [[maybe_unused]] const ent_id& eid, [[maybe_unused]] const com_id& primary_cid, [[maybe_unused]] type_slot slot, primary<Primary>) {
+            return {};
+        }
+
+        visitor_key<Components...> key;
+    };
+
+    // ChunkVisitorTraits
+
+    /*! Names one array that a chunk visitor needs: components of type `T`, or the `ent_id`s when `T` is `ent_id`.
+     */
+    template <typename T>
+    struct chunk_column {
+        using type = T;
+    };
+
+    template <typename Param>
+    struct chunk_param {
+        using key_type = Param;
+        static constexpr bool is_column = false;
+    };
+
+    template <typename T>
+    struct chunk_param<span<T>> {
+        using key_type = std::remove_const_t<T>;
+        static constexpr bool is_column = !std::is_same_v<key_type, ent_id>;
+    };
+
+    template <typename T>
+    struct chunk_param<soa_span<T>> {
+        using key_type = T;
+        static constexpr bool is_column = true;
+    };
+
+    /*! Parameters of a `visit_chunks` visitor.
+     *
+     * `span<T>` and `span<const T>` load components of type `T`, and `span<const ent_id>` loads the entity IDs.
+     * `soa_span<T>` loads field-split components. `require<T>`, `tag<T>`, and `deny<T>` only filter.
+     */
+    template <typename... Params>
+    struct chunk_visitor_traits_impl {
+        static constexpr std::size_t num_columns = (std::size_t{0} + ... + std::size_t{chunk_param<Params>::is_column});
+
+        chunk_visitor_traits_impl() = default;
+
+        explicit chunk_visitor_traits_impl(DB& db)
+            : key(db) {}
+
+        template <typename Signature>
+        bool matches(const Signature& signature) const {
+            return key.matches(signature);
+        }
+
+        /*! Calls the visitor with `size` elements of each requested array.
+         *
+         * `source(chunk_column<T>{})` must return a pointer to the first element.
+         */
+        template <typename Visitor, typename Source>
+        void apply(Visitor& visitor, std::size_t size, Source&& source) const {
+            visitor(get_param<Params>(size, source)...);
+        }
+
+        /*! Calls `callback(chunk_column<T>{})` for every component column.
+         */
+        template <typename Callback>
+        static void for_each_column(Callback&& callback) {
+            (for_column<Params>(callback), ...);
+        }
+
+    private:
+        template <typename Param, typename Callback>
+        static void for_column([[maybe_unused]] Callback& callback) {
+            if constexpr (chunk_param<Param>::is_column) {
+                callback(chunk_column<typename chunk_param<Param>::key_type>{});
+            }
+        }
+
+        template <typename Param, typename Source>
+        static Param get_param([[maybe_unused]] std::size_t size, [[maybe_unused]] Source& source) {
+            using category = typename component_traits<typename chunk_param<Param>::key_type>::category;
+            if constexpr (std::is_same_v<category, component_tags::eid>) {
+                static_assert(std::is_same_v<Param, span<const ent_id>>, "Chunk visitors receive entity IDs as span<const ent_id>");
+                return Param(source(chunk_column<ent_id>{}), size);
+            } else if constexpr (chunk_param<Param>::is_column) {
+                return Param(source(chunk_column<typename chunk_param<Param>::key_type>{}), size);
+            } else {
+                static_assert(std::is_base_of_v<component_tags::unit, category>,
+                    "Chunk visitor parameters must be span<T>, require<T>, tag<T>, or deny<T>");
+                return {};
+            }
+        }
+
+        visitor_key<typename chunk_param<Params>::key_type...> key;
+    };
+
+    template <typename Visitor>
+    struct visitor_traits : visitor_traits<decltype(&std::decay_t<Visitor>::operator())> {
+        using visitor_traits<decltype(&std::decay_t<Visitor>::operator())>::visitor_traits;
+    };
+
+    template <typename R, typename... Ts>
+    struct visitor_traits<R (&)(Ts...)> : visitor_traits_impl<std::decay_t<Ts>...> {
+        using visitor_traits_impl<std::decay_t<Ts>...>::visitor_traits_impl;
+    };
+
+    template <typename Visitor, typename R, typename... Ts>
+    struct visitor_traits<R (Visitor::*)(Ts...)> : visitor_traits_impl<std::decay_t<Ts>...> {
+        using visitor_traits_impl<std::decay_t<Ts>...>::visitor_traits_impl;
+    };
+
+    template <typename Visitor, typename R, typename... Ts>
+    struct visitor_traits<R (Visitor::*)(Ts...) const> : visitor_traits_impl<std::decay_t<Ts>...> {
+        using visitor_traits_impl<std::decay_t<Ts>...>::visitor_traits_impl;
+    };
+
+    template <typename Visitor, typename R, typename... Ts>
+    struct visitor_traits<R (Visitor::*)(Ts...)&> : visitor_traits_impl<std::decay_t<Ts>...> {
+        using visitor_traits_impl<std::decay_t<Ts>...>::visitor_traits_impl;
+    };
+
+    template <typename Visitor, typename R, typename... Ts>
+    struct visitor_traits<R (Visitor::*)(Ts...) const &> : visitor_traits_impl<std::decay_t<Ts>...> {
+        using visitor_traits_impl<std::decay_t<Ts>...>::visitor_traits_impl;
+    };
+
+    template <typename Visitor, typename R, typename... Ts>
+    struct visitor_traits<R (Visitor::*)(Ts...) &&> : visitor_traits_impl<std::decay_t<Ts>...> {
+        using visitor_traits_impl<std::decay_t<Ts>...>::visitor_traits_impl;
+    };
+};
+
+// Component Set
+
+class component_set {
+public:
+    using size_type = std::size_t;
+    virtual ~component_set() = 0;
+    virtual void remove(size_type entid) = 0;
+
+    /*! Removes the components of several distinct entities.
+     *
+     * The array is used as scratch space, so its contents are unspecified afterwards.
+     */
+    virtual void remove_many(size_type* entids, size_type num_entids) = 0;
+    virtual void compact() = 0;
+
+    size_type get_count() const {
+        return count;
+    }
+
+    /*! Changes whenever a component that stays in the set gets a new ComID, so saved ComIDs can be checked.
+     */
+    size_type get_layout_version() const {
+        return layout_version;
+    }
+
+protected:
+    void set_count(size_type new_count) {
+        count = new_count;
+    }
+
+    void swap_counts(component_set& other) noexcept {
+        std::swap(count, other.count);
+        std::swap(layout_version, other.layout_version);
+    }
+
+    void relocated() {
+        ++layout_version;
+    }
+
+private:
+    size_type count = 0;
+    size_type layout_version = 0;
+};
+
+inline component_set::~component_set() = default;
+
+template <typename T, typename Index = std::size_t, typename Policy = storage_policy_t<T>>
+class component_set_impl;
+
+template <typename T, typename Index>
+class component_set_impl<T, Index, storage_policy::stable> final : public component_set {
+public:
+    component_set_impl() = default;
+
+    /*! Takes the other set's components, leaving it empty.
+     */
+    component_set_impl(component_set_impl&& other) noexcept {
+        swap_contents(other);
+    }
+
+    component_set_impl& operator=(component_set_impl&& other) noexcept {
+        swap_contents(other);
+        return *this;
+    }
+
+    virtual ~component_set_impl() override {
+        for_each_valid(0, capacity(), [&](size_type i) {
+            auto bucket = get_bucket_index(i);
+            auto rel_index = get_relative_index(i);
+            buckets[bucket][rel_index].component.~T();
+        });
+    }
+
+    size_type assign(size_type entid, T com) {
+        size_type index;
+
+        if (free_slots.empty()) {
+            index = back_index;
+            if (get_bucket_index(index) == buckets.size()) {
+                add_bucket();
+            }
+            ++back_index;
+        } else {
+            index = free_slots.back();
+            free_slots.pop_back();
+        }
+
+        new (&get_com(index)) T(std::move(com));
+        entid_to_comid.set(entid, index);
+        comid_to_entid[index] = static_cast<Index>(entid);
+        occupancy[index / occupancy_word_bits] |= occupancy_word{1} << (index % occupancy_word_bits);
+
+        set_count(get_count() + 1);
+
+        return index;
+    }
+
+    /*! Makes room for `num_new` more components, owned by entities with indices below `num_entids`.
+     */
+    void reserve(size_type num_entids, size_type num_new) {
+        entid_to_comid.reserve(num_entids);
+
+        auto num_free = free_slots.size();
+
+        if (num_new > num_free) {
+            auto num_slots = back_index + (num_new - num_free);
+            while (get_total_size(buckets.size()) < num_slots) {
+                add_bucket();
+            }
+        }
+    }
+
+    virtual void remove(size_type entid) override final {
+        auto index = entid_to_comid.get(entid);
+        auto bucket = get_bucket_index(index);
+        auto rel_index = get_relative_index(index);
+        auto& slot = buckets[bucket][rel_index];
+
+        slot.component.~T();
+        free_slots.push_back(index);
+        comid_to_entid[index] = null_id;
+        occupancy[index / occupancy_word_bits] &= ~(occupancy_word{1} << (index % occupancy_word_bits));
+
+        set_count(get_count() - 1);
+    }
+
+    /*! Frees every slot at once. The slots are pushed so that the lowest ones are reused first.
+     */
+    virtual void remove_many(size_type* entids, size_type num_entids) override final {
+        auto comids = entids;
+        for (auto i = size_type{0}; i < num_entids; ++i) {
+            comids[i] = entid_to_comid.get(entids[i]);
+        }
+        std::sort(comids, comids + num_entids, std::greater<>{});
+
+        for (auto i = size_type{0}; i < num_entids; ++i) {
+            auto index = comids[i];
+            get_com(index).~T();
+            comid_to_entid[index] = null_id;
+            occupancy[index / occupancy_word_bits] &= ~(occupancy_word{1} << (index % occupancy_word_bits));
+        }
+
+        free_slots.insert(free_slots.end(), comids, comids + num_entids);
+
+        set_count(get_count() - num_entids);
+    }
+
+    /*! Moves all components into a dense prefix, ordered by entity index, and releases unused buckets.
+     *
+     * Components are relocated in place by following the permutation, so at most one extra component is live at a time.
+     */
+    virtual void compact() override final {
+        relocated();
+
+        auto live = std::vector<size_type>{};
+        live.reserve(get_count());
+        for_each_valid(0, capacity(), [&](size_type comid) {
+            live.push_back(comid_to_entid[comid]);
+        });
+        std::sort(live.begin(), live.end());
+
+        for (auto target = size_type{0}; target < live.size(); ++target) {
+            auto entid = live[target];
+            auto source = entid_to_comid.get(entid);
+
+            if (source == target) {
+                continue;
+            }
+
+            auto& dest = get_com(target);
+            auto& src = get_com(source);
+
+            if (is_valid(target)) {
+                // Positions before target are final, so the displaced component belongs further along.
+                auto displaced = comid_to_entid[target];
+                T tmp(std::move(dest));
+                dest.~T();
+                new (&dest) T(std::move(src));
+                src.~T();
+                new (&src) T(std::move(tmp));
+                entid_to_comid.set(displaced, source);
+                comid_to_entid[source] = displaced;
+            } else {
+                new (&dest) T(std::move(src));
+                src.~T();
+                comid_to_entid[source] = null_id;
+            }
+
+            entid_to_comid.set(entid, target);
+            comid_to_entid[target] = static_cast<Index>(entid);
+        }
+
+        auto num_buckets = layout::buckets_for(live.size());
+        buckets.resize(num_buckets);
+        buckets.shrink_to_fit();
+        comid_to_entid.resize(get_total_size(num_buckets));
+        comid_to_entid.shrink_to_fit();
+        std::fill(comid_to_entid.begin() + live.size(), comid_to_entid.end(), null_id);
+
+        occupancy.assign(get_total_size(num_buckets) / occupancy_word_bits, 0);
+        occupancy.shrink_to_fit();
+        std::fill(occupancy.begin(), occupancy.begin() + live.size() / occupancy_word_bits, ~occupancy_word{0});
+        if (live.size() % occupancy_word_bits != 0) {
+            occupancy[live.size() / occupancy_word_bits] = ~(~occupancy_word{0} << (live.size() % occupancy_word_bits));
+        }
+
+        entid_to_comid.truncate(live.empty() ? 0 : live.back() + 1);
+
+        free_slots.clear();
+        free_slots.shrink_to_fit();
+        back_index = live.size();
+    }
+
+    bool is_valid(size_type comid) const {
+        return comid_to_entid[comid] != null_id;
+    }
+
+    size_type get_comid(size_type entid) const {
+        return entid_to_comid.get(entid);
+    }
+
+    T& get_com(size_type comid) {
+        auto bucket = get_bucket_index(comid);
+        auto rel_index = get_relative_index(comid);
+        auto& slot = buckets[bucket][rel_index];
+        return slot.component;
+    }
+
+    size_type get_entid(size_type comid) const {
+        return comid_to_entid[comid];
+    }
+
+    size_type capacity() const {
+        return back_index;
+    }
+
+    /*! Calls `visitor(comid)` for every occupied slot in `[begin, end)`.
+     *
+     * Empty runs are skipped a whole occupancy word at a time.
+     * The occupancy is re-read after every call, so slots that the visitor frees are not visited,
+     * and slots it fills past the current one are.
+     */
+    template <typename Visitor>
+    void for_each_valid(size_type begin, size_type end, Visitor&& visitor) const {
+        for (auto w = begin / occupancy_word_bits, last = (end + occupancy_word_bits - 1) / occupancy_word_bits; w < last; ++w) {
+            auto base = w * occupancy_word_bits;
+            auto mask = base < begin ? ~occupancy_word{0} << (begin - base) : ~occupancy_word{0};
+            auto word = occupancy[w] & mask;
+            while (word != 0) {
+                auto comid = base + countr_zero(word);
+                if (comid >= end) {
+                    return;
+                }
+                visitor(comid);
+                mask = ~occupancy_word{0} << (comid - base) << 1;
+                word = occupancy[w] & mask;
+            }
+        }
+    }
+
+    /*! Calls `visitor(begin, end)` for every run of occupied slots. Runs never cross a bucket boundary.
+     */
+    template <typename Visitor>
+    void for_each_run(Visitor&& visitor) const {
+        auto run_begin = size_type{0};
+        auto in_run = false;
+
+        for (auto w = size_type{0}, last = (capacity() + occupancy_word_bits - 1) / occupancy_word_bits; w < last; ++w) {
+            auto base = w * occupancy_word_bits;
+            auto word = occupancy[w];
+
+            if (in_run && get_relative_index(base) == 0) {
+                visitor(run_begin, base);
+                in_run = false;
+            }
+
+            for (auto pos = size_type{0}; pos < occupancy_word_bits;) {
+                auto bits = (in_run ? ~word : word) >> pos;
+                if (bits == 0) {
+                    break;
+                }
+                pos += countr_zero(bits);
+                if (in_run) {
+                    visitor(run_begin, base + pos);
+                } else {
+                    run_begin = base + pos;
+                }
+                in_run = !in_run;
+            }
+        }
+
+        if (in_run) {
+            visitor(run_begin, capacity());
+        }
+    }
+
+    /*! Pointer to the component in slot `comid`, which continues up to the end of the slot's run.
+     */
+    T* run_data(size_type comid) {
+        return &get_com(comid);
+    }
+
+private:
+    using occupancy_word = std::uint64_t;
+
+    static constexpr size_type occupancy_word_bits = 64;
+
+    // Slots are exactly the size of T. Free slots are tracked in `free_slots`, not in the slots themselves.
+    union storage {
+        T component;
+
+        storage() {}
+        ~storage() {}
+    };
+
+    sparse_index<Index> entid_to_comid;
+    std::vector<Index> comid_to_entid;
+    std::vector<std::unique_ptr<storage[]>> buckets;
+    std::vector<occupancy_word> occupancy;
+    std::vector<Index> free_slots;
+    size_type back_index = 0;
+
+    using layout = bucket_layout<T>;
+
+    static_assert(layout::first_size % occupancy_word_bits == 0, "Buckets must hold whole occupancy words");
+    static constexpr Index null_id = static_cast<Index>(-1);
+
+    void swap_contents(component_set_impl& other) noexcept {
+        swap_counts(other);
+        entid_to_comid.swap(other.entid_to_comid);
+        comid_to_entid.swap(other.comid_to_entid);
+        buckets.swap(other.buckets);
+        occupancy.swap(other.occupancy);
+        free_slots.swap(other.free_slots);
+        std::swap(back_index, other.back_index);
+    }
+
+    static size_type get_bucket_index(size_type idx) {
+        return layout::bucket_index(idx);
+    }
+
+    static size_type get_relative_index(size_type idx) {
+        return layout::relative_index(idx);
+    }
+
+    static size_type get_total_size(size_type num_buckets) {
+        return layout::bucket_begin(num_buckets);
+    }
+
+    void add_bucket() {
+        auto size = layout::bucket_capacity(buckets.size());
+        buckets.push_back(std::make_unique<storage[]>(size));
+        comid_to_entid.resize(comid_to_entid.size() + size, null_id);
+        occupancy.resize(occupancy.size() + size / occupancy_word_bits, 0);
+    }
+};
+
+template <typename T, typename Index>
+class component_set_impl<T, Index, storage_policy::dense> final : public component_set {
+public:
+    component_set_impl() = default;
+
+    /*! Takes the other set's components, leaving it empty.
+     */
+    component_set_impl(component_set_impl&& other) noexcept {
+        swap_contents(other);
+    }
+
+    component_set_impl& operator=(component_set_impl&& other) noexcept {
+        swap_contents(other);
+        return *this;
+    }
+
+    virtual ~component_set_impl() override {
+        for (auto i = size_type{0}, sz = capacity(); i < sz; ++i) {
+            get_com(i).~T();
+        }
+    }
+
+    size_type assign(size_type entid, T com) {
+        auto index = get_count();
+        auto bucket = get_bucket_index(index);
+
+        if (bucket == buckets.size()) {
+            add_bucket();
+        }
+
+        new (&get_com(index)) T(std::move(com));
+        entid_to_comid.set(entid, index);
+        comid_to_entid.push_back(static_cast<Index>(entid));
+
+        set_count(index + 1);
+
+        return index;
+    }
+
+    /*! Makes room for `num_new` more components, owned by entities with indices below `num_entids`.
+     */
+    void reserve(size_type num_entids, size_type num_new) {
+        entid_to_comid.reserve(num_entids);
+
+        auto num_slots = get_count() + num_new;
+        comid_to_entid.reserve(num_slots);
+        while (layout::bucket_begin(buckets.size()) < num_slots) {
+            add_bucket();
+        }
+    }
+
+    virtual void remove(size_type entid) override final {
+        auto index = entid_to_comid.get(entid);
+        auto last = get_count() - 1;
+
+        if (index != last) {
+            relocated();
+            auto& hole = get_com(index);
+            hole.~T();
+            new (&hole) T(std::move(get_com(last)));
+            auto moved = comid_to_entid[last];
+            entid_to_comid.set(moved, index);
+            comid_to_entid[index] = moved;
+        }
+
+        get_com(last).~T();
+        comid_to_entid.pop_back();
+
+        set_count(last);
+    }
+
+    /*! Fills the holes below the new count with the surviving components past it, moving each survivor once.
+     */
+    virtual void remove_many(size_type* entids, size_type num_entids) override final {
+        auto comids = entids;
+        for (auto i = size_type{0}; i < num_entids; ++i) {
+            comids[i] = entid_to_comid.get(entids[i]);
+            get_com(comids[i]).~T();
+            comid_to_entid[comids[i]] = null_id;
+        }
+        std::sort(comids, comids + num_entids);
+
+        auto new_count = get_count() - num_entids;
+        auto source = new_count;
+
+        for (auto i = size_type{0}; i < num_entids && comids[i] < new_count; ++i) {
+            while (comid_to_entid[source] == null_id) {
+                ++source;
+            }
+            relocated();
+            auto& from = get_com(source);
+            new (&get_com(comids[i])) T(std::move(from));
+            from.~T();
+            auto moved = comid_to_entid[source];
+            entid_to_comid.set(moved, comids[i]);
+            comid_to_entid[comids[i]] = moved;
+            ++source;
+        }
+
+        comid_to_entid.resize(new_count);
+
+        set_count(new_count);
+    }
+
+    /*! Exchanges two components, along with their owners.
+     */
+    void swap_comids(size_type a, size_type b) {
+        if (a == b) {
+            return;
+        }
+
+        relocated();
+
+        using std::swap;
+        swap(get_com(a), get_com(b));
+        swap(comid_to_entid[a], comid_to_entid[b]);
+        entid_to_comid.set(comid_to_entid[a], a);
+        entid_to_comid.set(comid_to_entid[b], b);
+    }
+
+    /*! Sets the owning group's size, which `compact()` must leave in place.
+     */
+    void set_group_size(const size_type* size) {
+        group_size = size;
+    }
+
+    /*! Sorts the components by entity index and releases unused buckets.
+     *
+     * Components packed at the front by an owning group are not moved.
+     */
+    virtual void compact() override final {
+        relocated();
+
+        auto first = group_size ? *group_size : size_type{0};
+        auto order = std::vector<size_type>(comid_to_entid.begin() + first, comid_to_entid.end());
+        std::sort(order.begin(), order.end());
+
+        for (auto target = first; target < get_count(); ++target) {
+            auto entid = order[target - first];
+            auto source = entid_to_comid.get(entid);
+
+            if (source == target) {
+                continue;
+            }
+
+            auto& dest = get_com(target);
+            auto& src = get_com(source);
+            auto displaced = comid_to_entid[target];
+            T tmp(std::move(dest));
+            dest.~T();
+            new (&dest) T(std::move(src));
+            src.~T();
+            new (&src) T(std::move(tmp));
+            entid_to_comid.set(displaced, source);
+            comid_to_entid[source] = displaced;
+            entid_to_comid.set(entid, target);
+            comid_to_entid[target] = static_cast<Index>(entid);
+        }
+
+        buckets.resize(layout::buckets_for(get_count()));
+        buckets.shrink_to_fit();
+        comid_to_entid.shrink_to_fit();
+
+        auto last_entid = std::max_element(comid_to_entid.begin(), comid_to_entid.end());
+        entid_to_comid.truncate(last_entid == comid_to_entid.end() ? 0 : *last_entid + 1);
+    }
+
+    bool is_valid(size_type comid) const {
+        return comid < get_count();
+    }
+
+    size_type get_comid(size_type entid) const {
+        return entid_to_comid.get(entid);
+    }
+
+    T& get_com(size_type comid) {
+        auto bucket = get_bucket_index(comid);
+        auto rel_index = get_relative_index(comid);
+        auto& slot = buckets[bucket][rel_index];
+        return slot.component;
+    }
+
+    size_type get_entid(size_type comid) const {
+        return comid_to_entid[comid];
+    }
+
+    size_type capacity() const {
+        return get_count();
+    }
+
+    /*! Calls `visitor(comid)` for every component in `[begin, end)`.
+     *
+     * Components are visited from back to front, so the visitor may remove the component it was given:
+     * the component that fills the hole has already been visited.
+     * Components added by the visitor are not visited.
+     */
+    template <typename Visitor>
+    void for_each_valid(size_type begin, size_type end, Visitor&& visitor) const {
+        for (auto i = std::min(end, get_count()); i > begin;) {
+            --i;
+            visitor(i);
+            // Clamp instead of checking each index, in case the visitor removed more than its own component.
+            i = std::min(i, get_count());
+        }
+    }
+
+    /*! Calls `visitor(begin, end)` for every run of components in `[first, last)`. Runs never cross a bucket boundary.
+     */
+    template <typename Visitor>
+    void for_each_run(Visitor&& visitor, size_type first = 0, size_type last = static_cast<size_type>(-1)) const {
+        last = std::min(last, get_count());
+        for (auto begin = first; begin < last;) {
+            auto end = std::min(layout::bucket_begin(get_bucket_index(begin) + 1), last);
+            visitor(begin, end);
+            begin = end;
+        }
+    }
+
+    /*! Pointer to the component `comid`, which continues up to the end of its run.
+     */
+    T* run_data(size_type comid) {
+        return &get_com(comid);
+    }
+
+private:
+    union storage {
+        T component;
+
+        storage() {}
+        ~storage() {}
+    };
+
+    using layout = bucket_layout<T>;
+
+    sparse_index<Index> entid_to_comid;
+    std::vector<Index> comid_to_entid;
+    std::vector<std::unique_ptr<storage[]>> buckets;
+    const size_type* group_size = nullptr;
+
+    // Marks removed components while `remove_many()` runs.
+    static constexpr Index null_id = static_cast<Index>(-1);
+
+    void swap_contents(component_set_impl& other) noexcept {
+        swap_counts(other);
+        entid_to_comid.swap(other.entid_to_comid);
+        comid_to_entid.swap(other.comid_to_entid);
+        buckets.swap(other.buckets);
+        std::swap(group_size, other.group_size);
+    }
+
+    static size_type get_bucket_index(size_type idx) {
+        return layout::bucket_index(idx);
+    }
+
+    static size_type get_relative_index(size_type idx) {
+        return layout::relative_index(idx);
+    }
+
+    void add_bucket() {
+        buckets.push_back(std::make_unique<storage[]>(layout::bucket_capacity(buckets.size())));
+    }
+};
+
+template <typename T, typename Index, auto... Fields>
+class component_set_impl<T, Index, storage_policy::soa<Fields...>> final : public component_set {
+public:
+    using layout = soa_layout<storage_policy::soa<Fields...>>;
+    using pointers = typename layout::pointers;
+
+    component_set_impl() = default;
+
+    /*! Takes the other set's components, leaving it empty.
+     */
+    component_set_impl(component_set_impl&& other) noexcept {
+        swap_contents(other);
+    }
+
+    component_set_impl& operator=(component_set_impl&& other) noexcept {
+        swap_contents(other);
+        return *this;
+    }
+
+    size_type assign(size_type entid, T com) {
+        auto index = get_count();
+        auto bucket = get_bucket_index(index);
+
+        if (bucket == buckets.size()) {
+            add_bucket();
+        }
+
+        layout::store(get_pointers(index), std::move(com));
+        entid_to_comid.set(entid, index);
+        comid_to_entid.push_back(static_cast<Index>(entid));
+
+        set_count(index + 1);
+
+        return index;
+    }
+
+    /*! Makes room for `num_new` more components, owned by entities with indices below `num_entids`.
+     */
+    void reserve(size_type num_entids, size_type num_new) {
+        entid_to_comid.reserve(num_entids);
+
+        auto num_slots = get_count() + num_new;
+        comid_to_entid.reserve(num_slots);
+        while (buckets_layout::bucket_begin(buckets.size()) < num_slots) {
+            add_bucket();
+        }
+    }
+
+    virtual void remove(size_type entid) override final {
+        auto index = entid_to_comid.get(entid);
+        auto last = get_count() - 1;
+
+        if (index != last) {
+            relocated();
+            move_fields(get_pointers(last), get_pointers(index));
+            auto moved = comid_to_entid[last];
+            entid_to_comid.set(moved, index);
+            comid_to_entid[index] = moved;
+        }
+
+        comid_to_entid.pop_back();
+
+        set_count(last);
+    }
+
+    /*! Fills the holes below the new count with the surviving components past it, like the dense set.
+     */
+    virtual void remove_many(size_type* entids, size_type num_entids) override final {
+        auto comids = entids;
+        for (auto i = size_type{0}; i < num_entids; ++i) {
+            comids[i] = entid_to_comid.get(entids[i]);
+            comid_to_entid[comids[i]] = null_id;
+        }
+        std::sort(comids, comids + num_entids);
+
+        auto new_count = get_count() - num_entids;
+        auto source = new_count;
+
+        for (auto i = size_type{0}; i < num_entids && comids[i] < new_count; ++i) {
+            while (comid_to_entid[source] == null_id) {
+                ++source;
+            }
+            relocated();
+            move_fields(get_pointers(source), get_pointers(comids[i]));
+            auto moved = comid_to_entid[source];
+            entid_to_comid.set(moved, comids[i]);
+            comid_to_entid[comids[i]] = moved;
+            ++source;
+        }
+
+        comid_to_entid.resize(new_count);
+
+        set_count(new_count);
+    }
+
+    /*! Sorts the components by entity index and releases unused buckets.
+     */
+    virtual void compact() override final {
+        relocated();
+
+        auto order = comid_to_entid;
+        std::sort(order.begin(), order.end());
+
+        for (auto target = size_type{0}; target < order.size(); ++target) {
+            auto source = entid_to_comid.get(order[target]);
+            if (source != target) {
+                swap_fields(get_pointers(source), get_pointers(target));
+                auto displaced = comid_to_entid[target];
+                entid_to_comid.set(displaced, source);
+                comid_to_entid[source] = displaced;
+                entid_to_comid.set(order[target], target);
+                comid_to_entid[target] = order[target];
+            }
+        }
+
+        buckets.resize(buckets_layout::buckets_for(get_count()));
+        buckets.shrink_to_fit();
+        comid_to_entid.shrink_to_fit();
+
+        entid_to_comid.truncate(order.empty() ? 0 : order.back() + 1);
+    }
+
+    bool is_valid(size_type comid) const {
+        return comid < get_count();
+    }
+
+    size_type get_comid(size_type entid) const {
+        return entid_to_comid.get(entid);
+    }
+
+    soa_ref<T> get_com(size_type comid) {
+        return soa_ref<T>(get_pointers(comid));
+    }
+
+    size_type get_entid(size_type comid) const {
+        return comid_to_entid[comid];
+    }
+
+    size_type capacity() const {
+        return get_count();
+    }
+
+    /*! Calls `visitor(comid)` for every component in `[begin, end)`, from back to front.
+     */
+    template <typename Visitor>
+    void for_each_valid(size_type begin, size_type end, Visitor&& visitor) const {
+        for (auto i = std::min(end, get_count()); i > begin;) {
+            --i;
+            visitor(i);
+            i = std::min(i, get_count());
+        }
+    }
+
+    /*! Calls `visitor(begin, end)` for every run of components. Runs never cross a bucket boundary.
+     */
+    template <typename Visitor>
+    void for_each_run(Visitor&& visitor) const {
+        for (auto begin = size_type{0}; begin < get_count();) {
+            auto end = std::min(buckets_layout::bucket_begin(get_bucket_index(begin) + 1), get_count());
+            visitor(begin, end);
+            begin = end;
+        }
+    }
+
+    /*! Pointers to every field of component `comid`, each of which continues up to the end of its run.
+     */
+    pointers run_data(size_type comid) {
+        return get_pointers(comid);
+    }
+
+private:
+    // One array per field.
+    using bucket = std::tuple<std::unique_ptr<field_t<Fields>[]>...>;
+
+    sparse_index<Index> entid_to_comid;
+    std::vector<Index> comid_to_entid;
+    using buckets_layout = bucket_layout<T>;
+
+    std::vector<bucket> buckets;
+
+    static constexpr Index null_id = static_cast<Index>(-1);
+
+    void swap_contents(component_set_impl& other) noexcept {
+        swap_counts(other);
+        entid_to_comid.swap(other.entid_to_comid);
+        comid_to_entid.swap(other.comid_to_entid);
+        buckets.swap(other.buckets);
+    }
+
+    static size_type get_bucket_index(size_type idx) {
+        return buckets_layout::bucket_index(idx);
+    }
+
+    static size_type get_relative_index(size_type idx) {
+        return buckets_layout::relative_index(idx);
+    }
+
+    pointers get_pointers(size_type comid) const {
+        auto& b = buckets[get_bucket_index(comid)];
+        auto rel_index = get_relative_index(comid);
+        return std::apply([&](auto&... arrays) { return pointers{(arrays.get() + rel_index)...}; }, b);
+    }
+
+    void add_bucket() {
+        auto size = buckets_layout::bucket_capacity(buckets.size());
+        buckets.emplace_back(std::make_unique<field_t<Fields>[]>(size)...);
+    }
+
+    static void move_fields(const pointers& from, const pointers& to) {
+        ((*std::get<layout::template index<Fields>>(to) = std::move(*std::get<layout::template index<Fields>>(from))), ...);
+    }
+
+    static void swap_fields(const pointers& a, const pointers& b) {
+        using std::swap;
+        (swap(*std::get<layout::template index<Fields>>(a), *std::get<layout::template index<Fields>>(b)), ...);
+    }
+};
+
+template <typename T, typename Index>
+class component_set_impl<tag<T>, Index, tag_storage> final : public component_set {
+public:
+    virtual ~component_set_impl() = default;
+    virtual void remove([[maybe_unused]] size_type entid) override final {}
+    virtual void remove_many([[maybe_unused]] size_type* entids, [[maybe_unused]] size_type num_entids) override final {}
+    virtual void compact() override final {}
+};
+
+// Query Base
+
+/*! Incrementally maintained list of the entities that match a query.
+ *
+ * The database calls `refresh()` whenever an entity's signature changes in a way the query cares about,
+ * and `erase()` when an entity is destroyed.
+ *
+ * Next to each entity, the ComID of its lead component is saved, so visits do not have to look it up.
+ * The saved ComIDs are rebuilt when the lead set's layout version shows that components have moved.
+ */
+class query_base {
+public:
+    using size_type = std::size_t;
+
+    virtual ~query_base() = default;
+
+    virtual bool matches(const signature_ref& signature) const = 0;
+
+    /*! ComID of the entity's lead component, or 0 when the query has no lead component.
+     */
+    virtual size_type find_comid(size_type entid) const = 0;
+
+    void refresh(size_type entid, const signature_ref& signature) {
+        if (matches(signature)) {
+            insert(entid);
+        } else {
+            erase(entid);
+        }
+    }
+
+    void insert(size_type entid) {
+        if (entid >= positions.size()) {
+            positions.resize((entid + 1) * 3 / 2, null_position);
+        }
+        if (positions[entid] == null_position) {
+            positions[entid] = matched.size();
+            matched.push_back(entid);
+            comids.push_back(find_comid(entid));
+        }
+    }
+
+    void erase(size_type entid) {
+        if (entid >= positions.size() || positions[entid] == null_position) {
+            return;
+        }
+        auto pos = positions[entid];
+        auto last = matched.back();
+        matched[pos] = last;
+        comids[pos] = comids.back();
+        positions[last] = pos;
+        matched.pop_back();
+        comids.pop_back();
+        positions[entid] = null_position;
+    }
+
+    /*! Number of matching entities.
+     */
+    size_type size() const {
+        return matched.size();
+    }
+
+    /*! Calls `visitor(entid, comid)` for every matching entity, where `comid` is the ComID of its lead component.
+     *
+     * Entities are visited from back to front, so the visitor may remove the current entity from the query.
+     * Removing any other entity moves the last one into its place, which may then be visited twice.
+     * If the visitor moves components of the lead type, the remaining ComIDs are looked up instead.
+     */
+    template <typename Visitor>
+    void for_each(Visitor&& visitor) {
+        refresh_comids();
+        for (auto i = matched.size(); i > 0;) {
+            --i;
+            if (i < matched.size()) {
+                auto entid = matched[i];
+                visitor(entid, comids_current() ? comids[i] : find_comid(entid));
+            }
+        }
+    }
+
+protected:
+    void set_lead_set(const component_set* set) {
+        lead_set = set;
+        comids_version = set->get_layout_version();
+    }
+
+private:
+    static constexpr size_type null_position = static_cast<size_type>(-1);
+
+    bool comids_current() const {
+        return !lead_set || lead_set->get_layout_version() == comids_version;
+    }
+
+    void refresh_comids() {
+        if (!comids_current()) {
+            for (auto i = size_type{0}; i < matched.size(); ++i) {
+                comids[i] = find_comid(matched[i]);
+            }
+            comids_version = lead_set->get_layout_version();
+        }
+    }
+
+    std::vector<size_type> matched;
+    std::vector<size_type> comids;
+    std::vector<size_type> positions;
+    const component_set* lead_set = nullptr;
+    size_type comids_version = 0;
+};
+
+// Group Base
+
+/*! Owning group over several dense component sets.
+ *
+ * The first `size()` components of every owned set belong to the entities that have all of the owned components,
+ * in the same order. The database calls `enter()` after one of the owned components is added,
+ * and `leave()` before one is removed.
+ */
+class group_base {
+public:
+    using size_type = std::size_t;
+
+    virtual ~group_base() = default;
+
+    virtual void enter(size_type entid, const signature_ref& signature) = 0;
+    virtual void leave(size_type entid, const signature_ref& signature) = 0;
+
+    /*! Number of entities in the group.
+     */
+    size_type size() const {
+        return count;
+    }
+
+protected:
+    size_type count = 0;
+};
+
+// Opaque index
+
+template <typename Tag, typename Friend, typename Index>
+class opaque_index {
+public:
+    opaque_index() = default;
+
+    bool operator==(const opaque_index& other) {
+        return index == other.index;
+    }
+
+    Index get_index() const {
+        return index;
+    }
+
+private:
+    friend Friend;
+
+    opaque_index(Index i)
+        : index(i) {}
+
+    operator Index() const {
+        return index;
+    }
+
+    opaque_index& operator++() {
+        ++index;
+        return *this;
+    }
+
+    Index index;
+};
+
+template <typename DB>
+class basic_command_buffer;
+
+template <typename DB>
+class basic_thread_command_buffers;
+
+class archetype_database;
+
+template <typename... Coms>
+class static_database;
+
+template <typename DB, typename... Coms>
+class basic_query;
+
+template <typename DB, typename... Coms>
+class basic_group;
+
+/*! Database
+ *
+ * An Entity component Database. Uses the given allocator to allocate
+ * components, and may also use the same allocator for internal data.
+ *
+ * @warning
+ * This container does not perform any synchronization. Therefore, it is not
+ * considered "thread-safe".
+ *
+ * @tparam Config Configuration that sets the entity index and version types, such as `default_config`.
+ */
+template <typename Config>
+class basic_database {
+public:
+    using index_type = typename Config::index_type;
+    using version_type = typename Config::version_type;
+
+    using command_buffer = basic_command_buffer<basic_database>;
+    using thread_command_buffers = basic_thread_command_buffers<basic_database>;
+
+    template <typename... Coms>
+    using query = basic_query<basic_database, Coms...>;
+
+    template <typename... Coms>
+    using group = basic_group<basic_database, Coms...>;
+
+    // IDs
+
+    /*! Entity ID.
+     */
+    class ent_id {
+    public:
+        friend class basic_database;
+        friend class basic_command_buffer<basic_database>;
+        friend class archetype_database;
+        template <typename...>
+        friend class static_database;
+        using index_type = typename Config::index_type;
+        using version_type = typename Config::version_type;
+
+        bool operator==(const ent_id& other) const {
+            return index == other.index && version == other.version;
+        }
+
+        index_type get_index() const {
+            return index;
+        }
+
+    private:
+        ent_id(index_type i, version_type v)
+            : index(i), version(v) {}
+
+        index_type index = 0;
+        version_type version = 0;
+    };
+
+    /*! Component ID.
+     */
+    using com_id = opaque_index<struct com_id_tag, basic_database, component_set::size_type>;
+
+    /*! Creates a new Entity.
+     *
+     * Creates a new Entity that has no components.
+     *
+     * @return ID of the new Entity.
+     */
+    ent_id create_entity() {
+        assert(!in_par_visit && "Entities cannot be created during par_visit");
+
+        return allocate_entity();
+    }
+
+    /*! Creates several new Entities.
+     *
+     * Creates `num_entities` Entities that have no components, and writes their IDs to `out`.
+     *
+     * @param num_entities Number of Entities to create.
+     * @param out Output iterator that receives the new IDs.
+     * @return Output iterator past the last written ID.
+     */
+    template <typename OutputIt>
+    OutputIt create_entities(std::size_t num_entities, OutputIt out) {
+        assert(!in_par_visit && "Entities cannot be created during par_visit");
+
+        reserve_entities(num_entities);
+
+        for (auto n = std::size_t{0}; n < num_entities; ++n) {
+            *out = allocate_entity();
+            ++out;
+        }
+
+        return out;
+    }
+
+    /*! Creates several new Entities with the same set of components.
+     *
+     * Creates `num_entities` Entities, each with one component of every type in `Coms`.
+     * Storage for the entities and components is reserved up front.
+     *
+     * `generator(eid)` is called once per new Entity, and must return a `std::tuple<Coms...>`
+     * holding its component values. Tag components may be listed, and are just added.
+     *
+     * If the generator throws, the Entity it was called for is destroyed, and the Entities created before it are kept.
+     *
+     * @tparam Coms Types of the components to add.
+     * @param num_entities Number of Entities to create.
+     * @param generator Function that makes the components for each Entity.
+     */
+    template <typename... Coms, typename Generator>
+    void create_entities_with(std::size_t num_entities, Generator&& generator) {
+        assert(!in_par_visit && "Entities cannot be created during par_visit");
+
+        reserve_entities(num_entities);
+
+        auto num_recycled = std::min(num_entities, free_entities.size());
+        auto num_entids = signatures.size() + (num_entities - num_recycled);
+        auto com_sets = std::tuple<com_set_t<Coms>&...>{get_or_create_com_set<Coms>()...};
+        type_slot slots[] = {get_or_add_slot<Coms>()...};
+
+        (reserve_com_set(std::get<com_set_t<Coms>&>(com_sets), num_entids, num_entities), ...);
+
+        for (auto n = std::size_t{0}; n < num_entities; ++n) {
+            auto eid = allocate_entity();
+            auto index = eid.get_index();
+
+            // Each bit is set only once its component is stored, so that if the generator or a component's
+            // constructor throws, destroying the entity removes exactly the components it has.
+            try {
+                std::apply([&](auto&&... coms) {
+                    ((assign_com(std::get<com_set_t<Coms>&>(com_sets), index, std::forward<decltype(coms)>(coms)),
+                      set_com_bit(index, slots[index_of_v<Coms, Coms...>])), ...);
+                }, generator(eid));
+            } catch (...) {
+                destroy_entity(eid);
+                throw;
+            }
+
+            for (auto slot : slots) {
+                enter_group(index, slot);
+                refresh_queries(index, slot);
+            }
+        }
+    }
+
+    /*! Destroys an Entity.
+     *
+     * Destroys the given Entity and all associated components.
+     *
+     * If the Entity does not exist, no work is done.
+     *
+     * @param eid ID of the Entity to erase.
+     */
+    void destroy_entity(const ent_id& eid) {
+        assert(!in_par_visit && "Entities cannot be destroyed during par_visit");
+
+        const auto index = eid.get_index();
+
+        if (versions[index] != eid.version) {
+            return;
+        }
+
+        // Groups check the whole signature, so the entity must leave them before any component is removed.
+        if (!groups.empty()) {
+            for_each_com_bit(index, [&](type_slot slot) { leave_group(index, slot); });
+        }
+
+        for_each_com_bit(index, [&](type_slot slot) { component_sets[slot]->remove(index); });
+
+        erase_from_queries(index);
+        clear_signature(index);
+        ++versions[index];
+        free_entities.push_back(index);
+    }
+
+    /*! Destroys several Entities.
+     *
+     * Has the same effect as calling `destroy_entity()` for each ID in `[first, last)`,
+     * but removes components one component type at a time.
+     *
+     * IDs of Entities that do not exist are skipped.
+     *
+     * @param first Iterator to the first ID.
+     * @param last Iterator past the last ID.
+     */
+    template <typename InputIt>
+    void destroy_entities(InputIt first, InputIt last) {
+        assert(!in_par_visit && "Entities cannot be destroyed during par_visit");
+
+        // The lists keep their capacity between calls.
+        auto& removals = removal_scratch;
+        removals.resize(component_sets.size());
+
+        for (; first != last; ++first) {
+            const ent_id& eid = *first;
+            const auto index = eid.get_index();
+
+            if (versions[index] != eid.version) {
+                continue;
+            }
+
+            // Components are only removed after the loop, so the entity can leave its groups bit by bit.
+            if (!groups.empty()) {
+                for_each_com_bit(index, [&](type_slot slot) { leave_group(index, slot); });
+            }
+
+            for_each_com_bit(index, [&](type_slot slot) { removals[slot].push_back(index); });
+
+            // The version changes right away, so repeated IDs are skipped.
+            erase_from_queries(index);
+            clear_signature(index);
+            ++versions[index];
+            free_entities.push_back(index);
+        }
+
+        for (auto slot = type_slot{1}; slot < removals.size(); ++slot) {
+            if (!removals[slot].empty()) {
+                component_sets[slot]->remove_many(removals[slot].data(), removals[slot].size());
+                removals[slot].clear();
+            }
+        }
+    }
+
+    /*! Determines whether or not an entity exists.
+     *
+     * @param eid ID of the Entity to check.
+     */
+    bool exists(const ent_id& eid) const {
+        return versions[eid.index] == eid.version && (signatures[eid.index] & 1) != 0;
+    }
+
+    /*! Registers a component type before its first use.
+     *
+     * Assigns the type its slot in this Database, creates its storage, and widens every entity's signature to hold it,
+     * so that adding the first component of the type does not have to.
+     * Registering a type again has no effect.
+     *
+     * @tparam Com Type of the component to register.
+     */
+    template <typename Com>
+    void register_component() {
+        assert(!in_par_visit && "Components cannot be registered during par_visit");
+
+        get_or_create_com_set<Com>();
+
+        auto words = find_slot<Com>() / word_size;
+        if (words > overflow_stride) {
+            grow_overflow(words);
+        }
+    }
+
+    /*! Adds a component to an entity.
+     *
+     * If a component of the same type already exists for this entity,
+     * the given component will be forward-assigned to it.
+     *
+     * Otherwise, moves or copies the given component and adds it to the entity.
+     *
+     * @param eid Entity to attach new component to.
+     * @param com Component value.
+     * @return ID of component.
+     */
+    template <typename T>
+    com_id add_component(const ent_id& eid, T&& com) {
+        assert(!in_par_visit && "Components cannot be added during par_visit");
+
+        using com_type = std::decay_t<T>;
+        auto index = eid.get_index();
+        auto slot = get_or_add_slot<com_type>();
+        auto& com_set = get_or_create_com_set<com_type>();
+
+        com_id cid;
+
+        if (has_com_bit(index, slot)) {
+            cid = com_set.get_comid(index);
+            com_set.get_com(cid) = std::forward<T>(com);
+        } else {
+            cid = com_set.assign(index, std::forward<T>(com));
+            set_com_bit(index, slot);
+            enter_group(index, slot);
+            cid = com_set.get_comid(index);
+            refresh_queries(index, slot);
+        }
+
+        return cid;
+    }
+
+    /*! Create new Tag component.
+     *
+     * Adds the tag to the entity if it does not already exist.
+     *
+     * @param eid Entity to attach new Tag component to.
+     * @param com Tag value.
+     */
+    template <typename T>
+    void add_component(ent_id eid, tag<T>) {
+        assert(!in_par_visit && "Components cannot be added during par_visit");
+
+        auto index = eid.get_index();
+        auto slot = get_or_add_slot<tag<T>>();
+
+        get_or_create_com_set<tag<T>>();
+
+        set_com_bit(index, slot);
+        refresh_queries(index, slot);
+    }
+
+    template <typename T>
+    void add_component(ent_id eid, require<T> com) = delete;
+
+    template <typename T>
+    void add_component(ent_id eid, deny<T> com) = delete;
+
+    template <typename T>
+    void add_component(ent_id eid, optional<T> com) = delete;
+
+    template <typename T>
+    void add_component(ent_id eid, ent_id com) = delete;
+
+    /*! Remove a component from an entity.
+     *
+     * Removes the component from the entity and destroys it.
+     *
+     * If the entity does not exist, no work is done.
+     *
+     * @warning
+     * All ComIDs associated with the removed component will be invalidated.
+     *
+     * @tparam Com Type of the component to erase.
+     *
+     * @param eid ID of the entity.
+     */
+    template <typename Com>
+    void remove_component(ent_id eid) {
+        assert(!in_par_visit && "Components cannot be removed during par_visit");
+
+        auto index = eid.get_index();
+
+        if (versions[index] != eid.version) {
+            return;
+        }
+
+        auto slot = find_slot<Com>();
+        auto& com_set = *get_com_set<Com>(slot);
+        leave_group(index, slot);
+        com_set.remove(index);
+        unset_com_bit(index, slot);
+        refresh_queries(index, slot);
+    }
+
+    /*! Get a component.
+     *
+     * If Com is a non-pointer type, returns a reference to the component (a `soa_ref` for field-split components)
+     * without performing safe checks for existence.
+     *
+     * Otherwise, if Com is a pointer type,
+     * returns a pointer to the component of the pointed-to type that is associated with the given entity.
+     *
+     * If the entity has no associated component of the given type, returns nullptr.
+     *
+     * If the entity does not exist, returns nullptr.
+     *
+     * @tparam Com Type of the component to get.
+     *
+     * @param eid ID of the entity.
+     * @return Either a reference to the component, or a pointer to the component, or nullptr.
+     */
+    template <typename Com>
+    auto get_component(ent_id eid) -> std::conditional_t<std::is_pointer_v<Com>, Com, component_reference_t<Com>> {
+        auto index = eid.index;
+
+        if constexpr (std::is_pointer_v<Com>) {
+            using component_t = std::remove_pointer_t<Com>;
+            static_assert(!is_field_split_v<component_t>, "Field-split components have no address; use get_component<T>()");
+
+            if (versions[index] != eid.version) {
+                return nullptr;
+            }
+
+            auto slot = find_slot<component_t>();
+
+            if (has_component<component_t>(eid, slot)) {
+                auto& com_set = *get_com_set<component_t>(slot);
+                auto cid = com_set.get_comid(index);
+                return &com_set.get_com(cid);
+            } else {
+                return nullptr;
+            }
+        } else {
+            auto& com_set = *get_com_set<Com>();
+            auto cid = com_set.get_comid(index);
+            return com_set.get_com(cid);
+        }
+    }
+
+    /*! Get a component by its ID.
+     *
+     * Gets a reference to the component of the given type that has the given ID.
+     *
+     * @warning
+     * Behavior is undefined when no component is associated with the given ID.
+     *
+     * @tparam Com Type of the component to get.
+     *
+     * @param cid ID of the component.
+     * @return Reference to the component.
+     */
+    template <typename Com>
+    component_reference_t<Com> get_component_by_id(com_id cid) {
+        auto& com_set = *get_com_set<Com>();
+        return com_set.get_com(cid);
+    }
+
+    /*! Checks if an entity has a component.
+     *
+     * Returns whether or not the entity has a component of the
+     * associated type.
+     *
+     * If the entity does not exist, returns false.
+     *
+     * @tparam Com Type of the component to check.
+     *
+     * @param eid ID of the entity.
+     * @return True if the component exists.
+     */
+    template <typename Com>
+    bool has_component(ent_id eid) {
+        auto index = eid.get_index();
+
+        if (versions[index] != eid.version) {
+            return false;
+        }
+
+        return has_component<Com>(eid, find_slot<Com>());
+    }
+
+    /*! Visit the Database.
+     *
+     * Visit the Entities in the Database that match the given function's parameter types.
+     *
+     * The following parameter categories are accepted:
+     *
+     * - `T`, matches entities that have component `T`, and loads the component.
+     * - `tag<T>`, matches entities that have component `tag<T>`.
+     * - `require<T>`, matches entities that have component `T`, but does not load it.
+     * - `optional<T>`, matches all entities, loads component `T` if it exists.
+     * - `deny<T>`, matches entities that do *not* match component `T`.
+     * - `ent_id`, matches all entities, provides the `ent_id` of the current entity.
+     *
+     * `T` and `optional<T>` parameters will refer to the entity's matching component.
+     * `ent_id` parameters will contain the entity's `ent_id`.
+     * Other parameters will be their default value.
+     *
+     * Entities that do not match all given parameter conditions will be skipped.
+     *
+     * @warning Entities are visited in no particular order, so creating and destroying
+     *          entities or adding or removing components from within the visitor
+     *          could result in weird behavior. Record such changes in a `command_buffer`
+     *          and apply it with `playback()` after the visit instead.
+     *
+     * @tparam Visitor Visitor function type.
+     * @param visitor Visitor function.
+     */
+    template <typename Visitor>
+    void visit(Visitor&& visitor) {
+        using db_traits = database_traits<basic_database>;
+        using visitor_traits = typename db_traits::template visitor_traits<Visitor>;
+        using primary_candidates = typename visitor_traits::primary_candidates;
+
+        auto traits = visitor_traits(*this);
+
+        with_smallest_primary(traits, primary_candidates{}, [&](auto prim) {
+            visit_helper(traits, visitor, prim);
+        });
+    }
+
+    /*! Get a cached query.
+     *
+     * Returns the Database's query for the given parameter types, creating it on first use.
+     * The parameter types follow the same rules as visitor parameters.
+     *
+     * A query keeps a list of the entities that match it, which is updated whenever entities are created or destroyed,
+     * or components are added or removed. Visiting a query only visits the entities on that list.
+     *
+     * @tparam Coms Parameter types to match.
+     * @return Reference to the query, which remains valid for the lifetime of the Database.
+     */
+    template <typename... Coms>
+    query<Coms...>& get_query();
+
+    /*! Visit the entities that match a cached query.
+     *
+     * Works like `visit()`, but only the entities in the query's match list are considered.
+     * The visitor may be more specific than the query, in which case its parameters are checked for each entity.
+     * Otherwise, the match list is trusted, and the query's saved ComIDs are used for its lead component.
+     *
+     * @see get_query()
+     *
+     * @param q Query to visit.
+     * @param visitor Visitor function.
+     */
+    template <typename... Coms, typename Visitor>
+    void visit(query<Coms...>& q, Visitor&& visitor) {
+        using db_traits = database_traits<basic_database>;
+        using visitor_traits = typename db_traits::template visitor_traits<Visitor>;
+
+        using lead_type = typename query<Coms...>::lead_type;
+
+        auto traits = visitor_traits(*this);
+
+        q.for_each([&](std::size_t i, std::size_t cid) {
+            if constexpr (visitor_traits::template implied_by_v<Coms...>) {
+                traits.apply_matched(*this, make_ent_id(i), {cid}, visitor, primary<lead_type>{});
+            } else {
+                traits.apply(*this, make_ent_id(i), {cid}, visitor, primary<lead_type>{});
+            }
+        });
+    }
+
+    /*! Get an owning group.
+     *
+     * Returns the Database's group over the given component types, creating it on first use.
+     *
+     * The group keeps the components of every entity that has all of `Coms` packed at the front of each component set,
+     * in the same order, so visiting it walks the sets side by side without looking up each entity's components.
+     *
+     * Every component type must use `storage_policy::dense`, and a component type can be owned by only one group.
+     * A group must always be requested with its types in the same order.
+     *
+     * @tparam Coms Owned component types.
+     * @return Reference to the group, which remains valid for the lifetime of the Database.
+     */
+    template <typename... Coms>
+    group<Coms...>& get_group();
+
+    /*! Visit the entities in an owning group.
+     *
+     * Works like `visit()`, but only the group's entities are considered,
+     * and the owned components are read at the same index in each set.
+     *
+     * The visitor may remove owned components from the entity it was given.
+     *
+     * @see get_group()
+     *
+     * @param g Group to visit.
+     * @param visitor Visitor function.
+     */
+    template <typename... Coms, typename Visitor>
+    void visit(group<Coms...>& g, Visitor&& visitor) {
+        using db_traits = database_traits<basic_database>;
+        using visitor_traits = typename db_traits::template visitor_traits<Visitor>;
+
+        auto traits = visitor_traits(*this);
+        auto& lead_set = *get_com_set<first_t<Coms...>>();
+
+        for (auto i = g.size(); i > 0;) {
+            --i;
+            if (i < g.size()) {
+                auto entid = lead_set.get_entid(i);
+                traits.apply(*this, make_ent_id(entid), {i}, visitor, primary<grouped<Coms...>>{});
+            }
+        }
+    }
+
+    /*! Visit runs of contiguous components.
+     *
+     * The visitor is called with `span` parameters instead of references, once per run of matching entities
+     * whose components are stored next to each other. This allows hand-vectorized loops over whole runs.
+     *
+     * The following parameters are accepted:
+     *
+     * - `span<T>` or `span<const T>`, the components of type `T`. Exactly one component type may be loaded.
+     * - `span<const ent_id>`, the IDs of the entities.
+     * - `require<T>`, `tag<T>`, and `deny<T>`, which only filter entities, as in `visit()`.
+     *
+     * To load several component types at once, use an owning group, or `archetype_database`.
+     *
+     * @warning Creating or destroying entities and adding or removing components is not allowed during the visit.
+     *
+     * @tparam Visitor Visitor function type.
+     * @param visitor Visitor function.
+     */
+    template <typename Visitor>
+    void visit_chunks(Visitor&& visitor) {
+        using db_traits = database_traits<basic_database>;
+        using visitor_traits = typename db_traits::template visitor_traits<Visitor>;
+        using chunk_traits = typename visitor_traits::template rebind_t<db_traits::template chunk_visitor_traits_impl>;
+
+        static_assert(chunk_traits::num_columns == 1, "visit_chunks loads exactly one component type; use a group for more");
+
+        chunk_traits::for_each_column([&](auto column) {
+            using component_t = typename decltype(column)::type;
+
+            auto traits = chunk_traits(*this);
+            auto eids = std::vector<ent_id>{};
+
+            if (auto com_set = get_com_set<component_t>()) {
+                com_set->for_each_run([&](component_set::size_type begin, component_set::size_type end) {
+                    visit_chunk_runs(traits, visitor, *com_set, begin, end, eids);
+                });
+            }
+        });
+    }
+
+    /*! Visit runs of contiguous components in an owning group.
+     *
+     * Works like `visit_chunks(visitor)`, but any of the group's owned component types may be loaded,
+     * and every span covers the same entities.
+     *
+     * @see get_group()
+     *
+     * @param g Group to visit.
+     * @param visitor Visitor function.
+     */
+    template <typename... Coms, typename Visitor>
+    void visit_chunks(group<Coms...>& g, Visitor&& visitor) {
+        using db_traits = database_traits<basic_database>;
+        using visitor_traits = typename db_traits::template visitor_traits<Visitor>;
+        using chunk_traits = typename visitor_traits::template rebind_t<db_traits::template chunk_visitor_traits_impl>;
+
+        chunk_traits::for_each_column([](auto column) {
+            using component_t = typename decltype(column)::type;
+            static_assert((std::is_same_v<component_t, Coms> || ...), "Only the group's owned components can be loaded");
+        });
+
+        auto traits = chunk_traits(*this);
+        auto eids = std::vector<ent_id>{};
+        auto& lead_set = *get_com_set<first_t<Coms...>>();
+
+        lead_set.for_each_run([&](component_set::size_type begin, component_set::size_type end) {
+            visit_chunk_runs(traits, visitor, lead_set, begin, end, eids);
+        }, 0, g.size());
+    }
+
+    /*! Visit the Database in parallel.
+     *
+     * Works like `visit()`, but the primary component's storage (or the entity list, if there is no primary component)
+     * is split into ranges which are visited concurrently by a thread pool owned by the Database.
+     *
+     * The visitor is shared by all threads, so it must be safe to call concurrently.
+     * Each entity is visited by exactly one thread, so the visitor may freely modify the components it receives.
+     *
+     * If the visitor throws, ranges that have not started yet are skipped,
+     * and the first exception is rethrown from `par_visit` after every thread has stopped.
+     *
+     * @warning Creating or destroying entities and adding or removing components is not allowed
+     *          until `par_visit` returns. This is checked with an assertion.
+     *          The visitor must not call `par_visit`, `visit`, or `get_query`, or use a component type
+     *          that the Database has not used before, since those can change the Database's type slots.
+     *
+     * @throws std::logic_error if called from inside a `par_visit` visitor, which would otherwise deadlock.
+     *
+     * @tparam Visitor Visitor function type.
+     * @param visitor Visitor function.
+     */
+    template <typename Visitor>
+    void par_visit(Visitor&& visitor) {
+        // Checked before anything else, since the worker calling it would wait on its own pool.
+        if (in_par_visit) {
+            throw std::logic_error("par_visit cannot be called from inside a par_visit visitor");
+        }
+
+        using db_traits = database_traits<basic_database>;
+        using visitor_traits = typename db_traits::template visitor_traits<Visitor>;
+        using primary_candidates = typename visitor_traits::primary_candidates;
+
+        auto traits = visitor_traits(*this);
+
+        with_smallest_primary(traits, primary_candidates{}, [&](auto prim) {
+            par_visit_helper(traits, visitor, prim);
+        });
+    }
+
+    /*! Compact the storage of a component type.
+     *
+     * Moves all components of type Com into a contiguous block, ordered by entity index,
+     * so that visitors access them sequentially. Storage that is no longer needed is released.
+     *
+     * @warning
+     * All ComIDs, pointers, and references to components of type Com are invalidated.
+     *
+     * @tparam Com Type of the components to compact.
+     */
+    template <typename Com>
+    void compact() {
+        assert(!in_par_visit && "Components cannot be compacted during par_visit");
+
+        if (auto com_set = get_com_set<Com>()) {
+            com_set->compact();
+        }
+    }
+
+    /*! Compact the storage of all component types.
+     *
+     * @warning
+     * All ComIDs, pointers, and references to components are invalidated.
+     *
+     * @see compact()
+     */
+    void compact_all() {
+        assert(!in_par_visit && "Components cannot be compacted during par_visit");
+
+        for (auto& com_set : component_sets) {
+            if (com_set) {
+                com_set->compact();
+            }
+        }
+    }
+
+    /*! Applies the commands recorded in a command buffer, and clears it.
+     *
+     * Commands are applied in batches:
+     *
+     * 1. Pending entities are created, in the order they were recorded.
+     * 2. Components are added and removed, grouped by component type.
+     *    Commands for the same component type keep their recorded order.
+     * 3. Entities are destroyed.
+     *
+     * Commands that target entities which no longer exist are skipped,
+     * as are removals of components that the entity does not have.
+     *
+     * @param commands Command buffer to apply.
+     */
+    void playback(command_buffer& commands);
+
+    /*! Applies the commands recorded in a command buffer, and clears it.
+     *
+     * Writes the IDs of the created entities to `created`, in the order their
+     * `command_buffer::create_entity()` calls were made.
+     *
+     * @see playback(command_buffer&)
+     *
+     * @param commands Command buffer to apply.
+     * @param created Output iterator that receives the new IDs.
+     * @return Output iterator past the last written ID.
+     */
+    template <typename OutputIt>
+    OutputIt playback(command_buffer& commands, OutputIt created);
+
+    /*! Applies the commands recorded in per-thread command buffers, and clears them.
+     *
+     * The buffers are merged in a deterministic order before being applied.
+     *
+     * @see playback(command_buffer&)
+     * @see thread_command_buffers
+     *
+     * @param commands Command buffers to apply.
+     */
+    void playback(thread_command_buffers& commands);
+
+    /*! Applies the commands recorded in per-thread command buffers, and clears them.
+     *
+     * Writes the IDs of the created entities to `created`, in merged order.
+     *
+     * @see playback(thread_command_buffers&)
+     *
+     * @param commands Command buffers to apply.
+     * @param created Output iterator that receives the new IDs.
+     * @return Output iterator past the last written ID.
+     */
+    template <typename OutputIt>
+    OutputIt playback(thread_command_buffers& commands, OutputIt created);
+
+    /*! Get the number of entities in the Database.
+     *
+     * @return Number of entities in the Database.
+     */
+    auto size() const {
+        return signatures.size() - free_entities.size();
+    }
+
+    /*! Get the number of components of a certain type in the Database.
+     *
+     * @return Number of components of type Com.
+     */
+    template <typename Com>
+    component_set::size_type count() const {
+        if (auto set = get_com_set<Com>()) {
+            return set->get_count();
+        } else {
+            return 0;
+        }
+    }
+
+    /*! Get the number of words in each entity's signature.
+     *
+     * Each word holds the bits of 64 component types. Signatures are widened when a component type's bit does not fit,
+     * either when the type is registered or when its first component is added.
+     *
+     * @return Number of signature words per entity.
+     */
+    std::size_t signature_words() const {
+        return overflow_stride + 1;
+    }
+
+    /*! Converts an ent_id to a void* for storage purposes.
+     *
+     * @warning This is not a valid pointer and relies on widespread compiler-specific behavior.
+     *          Do not ever dereference the pointer.
+     *          Entity version checking is not preserved through conversion to and from pointers.
+     *          Null pointers are a valid result.
+     *
+     * @param eid Entity ID to convert to a pointer.
+     * @return A pointer which may be converted back into the same ID using from_ptr(ptr).
+     */
+    auto to_ptr(const ent_id& eid) const -> void* {
+        static_assert(sizeof(void*) >= sizeof(index_type), "Pointer conversion not possible");
+        return reinterpret_cast<void*>(static_cast<std::uintptr_t>(eid.get_index()));
+    }
+
+    /*! Converts a void* to an ent_id. The pointer must have been returned from to_ptr(eid).
+     *
+     * @warning The entity must not have been deleted. Version checking is not applied.
+     *
+     * @param ptr Pointer which was obtained from to_ptr(eid).
+     * @return The original ent_id that was passed to to_ptr(eid).
+     */
+    auto from_ptr(void* ptr) const -> ent_id {
+        auto i = reinterpret_cast<std::uintptr_t>(ptr);
+        return make_ent_id(static_cast<std::size_t>(i));
+    }
+
+private:
+    friend struct database_traits<basic_database>;
+
+    template <typename, typename...>
+    friend class basic_query;
+
+    template <typename Com>
+    using com_set_t = component_set_impl<Com, index_type>;
+
+    using word_type = dynamic_bitset::word_type;
+
+    static constexpr std::size_t word_size = dynamic_bitset::word_size;
+
+    ent_id make_ent_id(std::size_t index) const {
+        return {static_cast<index_type>(index), versions[index]};
+    }
+
+    template <typename Com>
+    component_reference_t<Com> get_component(ent_id eid, type_slot slot) {
+        auto& com_set = *unsafe_get_com_set<Com>(slot);
+        auto cid = com_set.get_comid(eid.get_index());
+        return com_set.get_com(cid);
+    }
+
+    template <typename Com>
+    component_reference_t<Com> get_component_by_id(com_id cid, type_slot slot) {
+        auto& com_set = *unsafe_get_com_set<Com>(slot);
+        return com_set.get_com(cid);
+    }
+
+    void reserve_entities(std::size_t num_entities) {
+        if (num_entities > free_entities.size()) {
+            signatures.reserve(signatures.size() + (num_entities - free_entities.size()));
+            versions.reserve(versions.size() + (num_entities - free_entities.size()));
+            overflow_words.reserve(overflow_words.size() + (num_entities - free_entities.size()) * overflow_stride);
+        }
+    }
+
+    ent_id allocate_entity() {
+        index_type index;
+
+        if (free_entities.empty()) {
+            assert(signatures.size() < static_cast<index_type>(-1) && "Too many entities for the configured index_type");
+            index = static_cast<index_type>(signatures.size());
+            signatures.push_back(0);
+            versions.push_back(0);
+            overflow_words.resize(overflow_words.size() + overflow_stride);
+        } else {
+            index = free_entities.back();
+            free_entities.pop_back();
+        }
+
+        signatures[index] |= 1;
+
+        for (auto q : unconstrained_queries) {
+            q->refresh(index, get_signature(index));
+        }
+
+        return {index, versions[index]};
+    }
+
+    void refresh_queries(index_type index, type_slot slot) {
+        if (slot < queries_by_slot.size()) {
+            for (auto q : queries_by_slot[slot]) {
+                q->refresh(index, get_signature(index));
+            }
+        }
+    }
+
+    /*! Removes the entity from the queries that could hold it, which must be done before its signature is cleared.
+     *
+     * A query that requires any component is listed under each of its watched slots, so only the lists for the
+     * entity's components and the unconstrained queries need to be checked.
+     */
+    void erase_from_queries(index_type index) {
+        for_each_com_bit(index, [&](type_slot slot) {
+            if (slot < queries_by_slot.size()) {
+                for (auto q : queries_by_slot[slot]) {
+                    q->erase(index);
+                }
+            }
+        });
+        for (auto q : unconstrained_queries) {
+            q->erase(index);
+        }
+    }
+
+    /*! Splits the components `[begin, end)` of `lead_set` into runs of matching entities, and visits each run.
+     *
+     * Every loaded component type must share ComIDs with `lead_set`.
+     */
+    template <typename Traits, typename Visitor, typename LeadSet>
+    void visit_chunk_runs(const Traits& traits, Visitor& visitor, const LeadSet& lead_set, component_set::size_type begin, component_set::size_type end, std::vector<ent_id>& eids) {
+        auto source = [&](component_set::size_type run_begin) {
+            return [&, run_begin](auto column) {
+                using component_t = typename decltype(column)::type;
+                if constexpr (std::is_same_v<component_t, ent_id>) {
+                    return static_cast<const ent_id*>(eids.data());
+                } else {
+                    return get_com_set<component_t>()->run_data(run_begin);
+                }
+            };
+        };
+
+        auto run_begin = begin;
+        eids.clear();
+
+        for (auto cid = begin; cid < end; ++cid) {
+            auto entid = lead_set.get_entid(cid);
+            if (traits.matches(get_signature(entid))) {
+                eids.push_back(make_ent_id(entid));
+            } else {
+                if (cid != run_begin) {
+                    traits.apply(visitor, cid - run_begin, source(run_begin));
+                }
+                run_begin = cid + 1;
+                eids.clear();
+            }
+        }
+
+        if (end != run_begin) {
+            traits.apply(visitor, end - run_begin, source(run_begin));
+        }
+    }
+
+    void enter_group(index_type index, type_slot slot) {
+        if (slot < groups_by_slot.size() && groups_by_slot[slot]) {
+            groups_by_slot[slot]->enter(index, get_signature(index));
+        }
+    }
+
+    void leave_group(index_type index, type_slot slot) {
+        if (slot < groups_by_slot.size() && groups_by_slot[slot]) {
+            groups_by_slot[slot]->leave(index, get_signature(index));
+        }
+    }
+
+    template <typename Com>
+    static void reserve_com_set(com_set_t<Com>& com_set, std::size_t num_entids, std::size_t num_new) {
+        if constexpr (!std::is_same_v<storage_policy_t<Com>, tag_storage>) {
+            com_set.reserve(num_entids, num_new);
+        }
+    }
+
+    template <typename Com, typename T>
+    static void assign_com(com_set_t<Com>& com_set, index_type index, T&& com) {
+        if constexpr (!std::is_same_v<storage_policy_t<Com>, tag_storage>) {
+            com_set.assign(index, std::forward<T>(com));
+        }
+    }
+
+    void playback_helper(command_buffer* const* buffers, std::size_t num_buffers, std::vector<ent_id>& created);
+
+    signature_ref get_signature(ent_id eid) const {
+        return get_signature(eid.get_index());
+    }
+
+    signature_ref get_signature(std::size_t index) const {
+        return {signatures[index], get_overflow(index), overflow_stride};
+    }
+
+    template <typename Com>
+    bool has_component(ent_id eid, type_slot slot) {
+        return slot != 0 && has_com_bit(eid.get_index(), slot);
+    }
+
+    const word_type* get_overflow(std::size_t index) const {
+        return overflow_words.data() + index * overflow_stride;
+    }
+
+    bool has_com_bit(std::size_t index, type_slot slot) const {
+        if (slot < word_size) {
+            return (signatures[index] >> slot) & 1;
+        }
+        auto w = slot / word_size - 1;
+        return w < overflow_stride && (overflow_words[index * overflow_stride + w] >> (slot % word_size)) & 1;
+    }
+
+    void set_com_bit(std::size_t index, type_slot slot) {
+        if (slot < word_size) {
+            signatures[index] |= word_type{1} << slot;
+            return;
+        }
+
+        auto w = slot / word_size - 1;
+
+        if (w >= overflow_stride) {
+            grow_overflow(w + 1);
+        }
+
+        overflow_words[index * overflow_stride + w] |= word_type{1} << (slot % word_size);
+    }
+
+    void unset_com_bit(std::size_t index, type_slot slot) {
+        if (slot < word_size) {
+            signatures[index] &= ~(word_type{1} << slot);
+        } else if (auto w = slot / word_size - 1; w < overflow_stride) {
+            overflow_words[index * overflow_stride + w] &= ~(word_type{1} << (slot % word_size));
+        }
+    }
+
+    /*! Clears every bit, including the "alive" bit.
+     */
+    void clear_signature(std::size_t index) {
+        signatures[index] = 0;
+        std::fill_n(overflow_words.begin() + index * overflow_stride, overflow_stride, 0);
+    }
+
+    /*! Widens every entity's row of overflow words to `stride` words.
+     */
+    void grow_overflow(std::size_t stride) {
+        auto words = std::vector<word_type>(signatures.size() * stride);
+        for (auto i = std::size_t{0}; i < signatures.size(); ++i) {
+            std::copy_n(overflow_words.begin() + i * overflow_stride, overflow_stride, words.begin() + i * stride);
+        }
+        overflow_words = std::move(words);
+        overflow_stride = stride;
+    }
+
+    /*! Calls `visitor(slot)` for every component of the entity.
+     */
+    template <typename Visitor>
+    void for_each_com_bit(std::size_t index, Visitor&& visitor) const {
+        for (auto word = signatures[index] & ~word_type{1}; word != 0; word &= word - 1) {
+            visitor(static_cast<type_slot>(countr_zero(word)));
+        }
+        auto overflow = get_overflow(index);
+        for (auto w = std::size_t{0}; w < overflow_stride; ++w) {
+            for (auto word = overflow[w]; word != 0; word &= word - 1) {
+                visitor((w + 1) * word_size + countr_zero(word));
+            }
+        }
+    }
+
+    template <typename Com>
+    com_set_t<Com>* get_com_set() {
+        return get_com_set<Com>(find_slot<Com>());
+    }
+
+    template <typename Com>
+    const com_set_t<Com>* get_com_set() const {
+        return get_com_set<Com>(find_slot<Com>());
+    }
+
+    template <typename Com>
+    com_set_t<Com>* get_com_set(type_slot slot) {
+        if (slot >= component_sets.size()) {
+            return nullptr;
+        }
+        return unsafe_get_com_set<Com>(slot);
+    }
+
+    template <typename Com>
+    const com_set_t<Com>* get_com_set(type_slot slot) const {
+        if (slot >= component_sets.size()) {
+            return nullptr;
+        }
+        return unsafe_get_com_set<Com>(slot);
+    }
+
+    template <typename Com>
+    com_set_t<Com>* unsafe_get_com_set(type_slot slot) {
+        auto& com_set = component_sets[slot];
+        auto com_set_impl = static_cast<com_set_t<Com>*>(com_set.get());
+        return com_set_impl;
+    }
+
+    template <typename Com>
+    const com_set_t<Com>* unsafe_get_com_set(type_slot slot) const {
+        auto& com_set = component_sets[slot];
+        auto com_set_impl = static_cast<const com_set_t<Com>*>(com_set.get());
+        return com_set_impl;
+    }
+
+    /*! This database's slot for a component type, or 0 if the type has not been used in this database.
+     */
+    type_slot find_slot(type_guid guid) const {
+        return guid < slots_by_guid.size() ? slots_by_guid[guid] : 0;
+    }
+
+    template <typename Com>
+    type_slot find_slot() const {
+        return find_slot(get_type_guid<Com>());
+    }
+
+    /*! This database's slot for a component type, which is assigned on first use.
+     */
+    template <typename Com>
+    type_slot get_or_add_slot() {
+        auto guid = get_type_guid<Com>();
+        if (auto slot = find_slot(guid); slot != 0) {
+            return slot;
+        }
+
+        assert(!in_par_visit && "New component types cannot be used during par_visit");
+
+        if (slots_by_guid.size() <= guid) {
+            slots_by_guid.resize(guid + 1);
+        }
+        // Slot 0 is the "alive" bit, so it never holds a component set.
+        auto slot = std::max(component_sets.size(), std::size_t{1});
+        slots_by_guid[guid] = slot;
+        component_sets.resize(slot + 1);
+        return slot;
+    }
+
+    /*! The slot of the component type that a query parameter watches, which is assigned if needed, or 0 for none.
+     */
+    template <typename Param>
+    type_slot watched_slot() {
+        using traits = typename database_traits<basic_database>::template component_traits<Param>;
+        if constexpr (std::is_base_of_v<component_tags::meta, typename traits::category>) {
+            return 0;
+        } else {
+            return get_or_add_slot<typename traits::component>();
+        }
+    }
+
+    template <typename Com>
+    com_set_t<Com>& get_or_create_com_set() {
+        auto& com_set = component_sets[get_or_add_slot<Com>()];
+        if (!com_set) {
+            com_set = std::make_unique<com_set_t<Com>>();
+        }
+        auto com_set_impl = static_cast<com_set_t<Com>*>(com_set.get());
+        return *com_set_impl;
+    }
+
+    /*! Calls `callback(primary<C>{})` for the candidate component `C` with the fewest instances.
+     *
+     * Ties go to the earliest parameter. When there are no candidates, `primary<void>` is used.
+     */
+    template <typename Traits, typename Callback, typename... Components>
+    void with_smallest_primary(Traits& traits, std::tuple<primary<Components>...>, Callback&& callback) {
+        if constexpr (sizeof...(Components) == 0) {
+            callback(primary<void>{});
+        } else {
+            component_set::size_type counts[] = {primary_count<Components>(traits)...};
+            auto smallest = std::min_element(std::begin(counts), std::end(counts)) - std::begin(counts);
+            auto i = std::ptrdiff_t{0};
+            ((i++ == smallest && (callback(primary<Components>{}), true)) || ...);
+        }
+    }
+
+    template <typename Component, typename Traits>
+    component_set::size_type primary_count(Traits& traits) {
+        if (auto com_set = get_com_set<Component>(traits.template get_slot<Component>())) {
+            return com_set->get_count();
+        } else {
+            return 0;
+        }
+    }
+
+    template <typename Traits, typename Visitor, typename Component>
+    void visit_helper(Traits& traits, Visitor& visitor, primary<Component>) {
+        if (auto com_set_ptr = get_com_set<Component>(traits.template get_slot<Component>())) {
+            visit_range(traits, visitor, *com_set_ptr, 0, com_set_ptr->capacity());
+        }
+    }
+
+    template <typename Traits, typename Visitor>
+    void visit_helper(Traits& traits, Visitor& visitor, primary<void>) {
+        visit_range(traits, visitor, 0, signatures.size());
+    }
+
+    template <typename Traits, typename Visitor, typename Component>
+    void par_visit_helper(const Traits& traits, Visitor& visitor, primary<Component>) {
+        if (auto com_set_ptr = get_com_set<Component>(traits.template get_slot<Component>())) {
+            auto& com_set = *com_set_ptr;
+            run_parallel(com_set.capacity(), [&](std::size_t begin, std::size_t end) {
+                auto local_traits = traits;
+                visit_range(local_traits, visitor, com_set, begin, end);
+            });
+        }
+    }
+
+    template <typename Traits, typename Visitor>
+    void par_visit_helper(const Traits& traits, Visitor& visitor, primary<void>) {
+        run_parallel(signatures.size(), [&](std::size_t begin, std::size_t end) {
+            auto local_traits = traits;
+            visit_range(local_traits, visitor, begin, end);
+        });
+    }
+
+    template <typename Traits, typename Visitor, typename Component>
+    void visit_range(Traits& traits, Visitor& visitor, com_set_t<Component>& com_set, std::size_t begin, std::size_t end) {
+        com_set.for_each_valid(begin, end, [&](component_set::size_type cid) {
+            auto i = com_set.get_entid(cid);
+            traits.apply(*this, make_ent_id(i), cid, visitor, primary<Component>{});
+        });
+    }
+
+    template <typename Traits, typename Visitor>
+    void visit_range(Traits& traits, Visitor& visitor, std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            if (signatures[i] & 1) {
+                traits.apply(*this, make_ent_id(i), {}, visitor, primary<void>{});
+            }
+        }
+    }
+
+    /*! Splits `[0, size)` into grains and runs them on the thread pool.
+     *
+     * Each grain calls `task(begin, end)` once for each chunk of `par_min_grain` indices.
+     * While a chunk runs, the worker's task is the index of the chunk, which does not depend on the number of threads.
+     *
+     * Structural changes are forbidden until all tasks have finished.
+     */
+    template <typename Task>
+    void run_parallel(std::size_t size, Task&& task) {
+        if (size == 0) {
+            return;
+        }
+
+        if (!pool) {
+            pool = std::make_unique<thread_pool>(default_concurrency() - 1);
+        }
+
+        // Several grains per thread so that uneven visitors still balance out.
+        auto grain = std::max(size / (pool->concurrency() * 8), par_min_grain);
+        grain = (grain + par_min_grain - 1) / par_min_grain * par_min_grain;
+        auto num_grains = (size + grain - 1) / grain;
+
+        // Cleared even if the visitor throws, so that the Database can still be changed afterwards.
+        // The calling thread's task is moved past the last chunk, as `thread_pool::run()` only counts grains.
+        struct par_visit_guard {
+            bool& flag;
+            std::size_t num_chunks;
+            ~par_visit_guard() {
+                flag = false;
+                this_worker.task = num_chunks;
+            }
+        };
+
+        in_par_visit = true;
+        auto guard = par_visit_guard{in_par_visit, (size + par_min_grain - 1) / par_min_grain};
+
+        // Tasks are numbered by chunk instead of by grain, so that commands are ordered the same way on every machine.
+        pool->run(num_grains, [&](std::size_t g) {
+            auto end = std::min((g + 1) * grain, size);
+            for (auto begin = g * grain; begin < end; begin += par_min_grain) {
+                this_worker.task = begin / par_min_grain;
+                task(begin, std::min(begin + par_min_grain, end));
+            }
+        });
+    }
+
+    static constexpr std::size_t par_min_grain = 1024;
+
+    // Entity records are split so that visits and existence checks only read what they need.
+    // `signatures` holds the first word of each entity's component bits, where bit 0 means that the entity exists.
+    // The rest of the bits are in `overflow_words`, a matrix with one row of `overflow_stride` words per entity.
+    // The stride only grows when this database first uses a slot past the current rows.
+    std::vector<word_type> signatures;
+    std::vector<version_type> versions;
+    std::vector<word_type> overflow_words;
+    std::size_t overflow_stride = 0;
+    std::vector<index_type> free_entities;
+    std::unique_ptr<thread_pool> pool;
+    bool in_par_visit = false;
+
+    // Component types are numbered per database, so that a database which uses few types has small signatures,
+    // even if other databases in the program use many. `slots_by_guid` maps type guids to slots, where 0 means unused.
+    // Slots are signature bits, and index `component_sets`, `queries_by_slot`, and `groups_by_slot`.
+    std::vector<type_slot> slots_by_guid;
+    std::vector<std::unique_ptr<component_set>> component_sets;
+
+    // Entity indices to remove from each component set, reused by `destroy_entities()`.
+    std::vector<std::vector<component_set::size_type>> removal_scratch;
+
+    // Cached queries are owned by `queries`, in the order this database created them.
+    // `query_slots_by_guid` maps query guids to one past the query's index, where 0 means not created yet.
+    // The other lists are for finding the queries that an entity change affects.
+    std::vector<std::size_t> query_slots_by_guid;
+    std::vector<std::unique_ptr<query_base>> queries;
+    std::vector<std::vector<query_base*>> queries_by_slot;
+    std::vector<query_base*> unconstrained_queries;
+
+    // Owning groups, and the group that owns each component type, if any.
+    std::vector<std::unique_ptr<group_base>> groups;
+    std::vector<group_base*> groups_by_slot;
+};
+
+template <typename DB, typename Com>
+struct query_lead_set {
+    using type = component_set_impl<Com, typename DB::index_type>;
+};
+
+template <typename DB>
+struct query_lead_set<DB, void> {
+    using type = component_set;
+};
+
+/*! Cached query
+ *
+ * A list of the entities that match a set of visitor parameter types, kept up to date by the database.
+ *
+ * Obtain one from `database::get_query()`, and visit it with `database::visit(query, visitor)`.
+ */
+template <typename DB, typename... Coms>
+class basic_query final : public query_base {
+public:
+    /*! The first parameter type that every match has stored, or `void` if there is none.
+     *
+     * Visits use the saved ComIDs of this type in place of a lookup.
+     */
+    using lead_type = typename first_candidate<primary_candidates_t<DB, Coms...>>::type;
+
+    explicit basic_query(DB& db)
+        : key(db) {
+        if constexpr (!std::is_void_v<lead_type>) {
+            lead_set = &db.template get_or_create_com_set<lead_type>();
+            set_lead_set(lead_set);
+        }
+    }
+
+    virtual bool matches(const signature_ref& signature) const override {
+        return key.matches(signature);
+    }
+
+    virtual size_type find_comid([[maybe_unused]] size_type entid) const override {
+        if constexpr (std::is_void_v<lead_type>) {
+            return 0;
+        } else {
+            return lead_set->get_comid(entid);
+        }
+    }
+
+private:
+    using lead_set_type = typename query_lead_set<DB, lead_type>::type;
+
+    typename database_traits<DB>::template visitor_key<Coms...> key;
+    const lead_set_type* lead_set = nullptr;
+};
+
+template <typename Config>
+template <typename... Coms>
+auto basic_database<Config>::get_query() -> query<Coms...>& {
+    using db_traits = database_traits<basic_database>;
+
+    assert(!in_par_visit && "Queries cannot be used during par_visit");
+
+    auto qguid = get_query_guid<Coms...>();
+
+    if (qguid >= query_slots_by_guid.size()) {
+        query_slots_by_guid.resize(qguid + 1);
+    }
+
+    if (query_slots_by_guid[qguid] == 0) {
+        // Optional parameters do not change whether an entity matches, so they are not watched.
+        type_slot slots[] = {watched_slot<Coms>()...};
+
+        auto q = std::make_unique<query<Coms...>>(*this);
+        constexpr bool unconstrained =
+            !((std::is_base_of_v<component_tags::positive, typename db_traits::template component_traits<Coms>::category> &&
+               !std::is_same_v<component_tags::inverted, typename db_traits::template component_traits<Coms>::category>) ||
+              ...);
+
+        for (auto i = std::size_t{0}; i < sizeof...(Coms); ++i) {
+            if (slots[i] != 0) {
+                if (slots[i] >= queries_by_slot.size()) {
+                    queries_by_slot.resize(slots[i] + 1);
+                }
+                auto& list = queries_by_slot[slots[i]];
+                if (std::find(list.begin(), list.end(), q.get()) == list.end()) {
+                    list.push_back(q.get());
+                }
+            }
+        }
+
+        if (unconstrained) {
+            unconstrained_queries.push_back(q.get());
+        }
+
+        for (auto i = std::size_t{0}; i < signatures.size(); ++i) {
+            if (signatures[i] & 1) {
+                q->refresh(i, get_signature(i));
+            }
+        }
+
+        queries.push_back(std::move(q));
+        query_slots_by_guid[qguid] = queries.size();
+    }
+
+    return static_cast<query<Coms...>&>(*queries[query_slots_by_guid[qguid] - 1]);
+}
+
+/*! Owning group
+ *
+ * Keeps the entities that have all of `Coms` packed at the front of each component set, in the same order.
+ *
+ * Obtain one from `database::get_group()`, and visit it with `database::visit(group, visitor)`.
+ */
+template <typename DB, typename... Coms>
+class basic_group final : public group_base {
+public:
+    static_assert(sizeof...(Coms) >= 2, "A group must own at least two component types");
+    static_assert((std::is_same_v<storage_policy_t<Coms>, storage_policy::dense> && ...),
+        "Grouped components must use storage_policy::dense");
+
+    explicit basic_group(DB& db, component_set_impl<Coms, typename DB::index_type>&... com_sets)
+        : sets(&com_sets...), key(db) {
+        (com_sets.set_group_size(&count), ...);
+    }
+
+    virtual ~basic_group() override {
+        std::apply([](auto*... com_sets) { (com_sets->set_group_size(nullptr), ...); }, sets);
+    }
+
+    virtual void enter(size_type entid, const signature_ref& signature) override {
+        if (key.matches(signature) && lead_set().get_comid(entid) >= count) {
+            std::apply([&](auto*... com_sets) { (com_sets->swap_comids(com_sets->get_comid(entid), count), ...); }, sets);
+            ++count;
+        }
+    }
+
+    virtual void leave(size_type entid, const signature_ref& signature) override {
+        if (key.matches(signature) && lead_set().get_comid(entid) < count) {
+            --count;
+            std::apply([&](auto*... com_sets) { (com_sets->swap_comids(com_sets->get_comid(entid), count), ...); }, sets);
+        }
+    }
+
+private:
+    component_set_impl<first_t<Coms...>, typename DB::index_type>& lead_set() const {
+        return *std::get<0>(sets);
+    }
+
+    std::tuple<component_set_impl<Coms, typename DB::index_type>*...> sets;
+    typename database_traits<DB>::template visitor_key<Coms...> key;
+};
+
+template <typename Config>
+template <typename... Coms>
+auto basic_database<Config>::get_group() -> group<Coms...>& {
+    using lead_type = first_t<Coms...>;
+
+    auto lead_slot = find_slot<lead_type>();
+
+    if (lead_slot < groups_by_slot.size() && groups_by_slot[lead_slot]) {
+        assert(dynamic_cast<group<Coms...>*>(groups_by_slot[lead_slot]) && "Component is already owned by another group");
+        return static_cast<group<Coms...>&>(*groups_by_slot[lead_slot]);
+    }
+
+    auto g = std::make_unique<group<Coms...>>(*this, get_or_create_com_set<Coms>()...);
+
+    for (auto slot : {find_slot<Coms>()...}) {
+        if (slot >= groups_by_slot.size()) {
+            groups_by_slot.resize(slot + 1);
+        }
+        assert(!groups_by_slot[slot] && "Component is already owned by another group");
+        groups_by_slot[slot] = g.get();
+    }
+
+    auto& lead_set = *get_com_set<lead_type>();
+    for (auto i = component_set::size_type{0}; i < lead_set.get_count(); ++i) {
+        auto entid = lead_set.get_entid(i);
+        g->enter(entid, get_signature(entid));
+    }
+
+    auto& result = *g;
+    groups.push_back(std::move(g));
+    return result;
+}
+
+// Command Arena
+
+/*! Bump allocator for recorded commands.
+ *
+ * Memory is only reclaimed all at once by `reset()`, which keeps the blocks for reuse.
+ */
+class command_arena {
+public:
+    void* allocate(std::size_t size, std::size_t alignment) {
+        for (;;) {
+            if (current < blocks.size()) {
+                auto& blk = blocks[current];
+                auto base = reinterpret_cast<std::uintptr_t>(blk.data.get());
+                auto offset = (base + used + alignment - 1) / alignment * alignment - base;
+                if (offset + size <= blk.size) {
+                    used = offset + size;
+                    return blk.data.get() + offset;
+                }
+                ++current;
+                used = 0;
+            } else {
+                auto block_size = std::max(size + alignment, default_block_size);
+                blocks.push_back({std::make_unique<unsigned char[]>(block_size), block_size});
+            }
+        }
+    }
+
+    void reset() {
+        current = 0;
+        used = 0;
+    }
+
+private:
+    struct block {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size;
+    };
+
+    static constexpr std::size_t default_block_size = 64 * 1024;
+
+    std::vector<block> blocks;
+    std::size_t current = 0;
+    std::size_t used = 0;
+};
+
+/*! Command buffer
+ *
+ * Records structural changes to a database, so that they can be applied later with `database::playback()`.
+ *
+ * Use a command buffer to create or destroy entities, or add or remove components, from inside a visitor.
+ * Recorded components are stored in an arena owned by the buffer, which is reused after each playback.
+ */
+template <typename DB>
+class basic_command_buffer {
+public:
+    using ent_id = typename DB::ent_id;
+
+    /*! Handle to an entity that will be created during playback.
+     */
+    class pending_entity {
+    public:
+        std::size_t get_index() const {
+            return index;
+        }
+
+    private:
+        friend class basic_command_buffer;
+
+        explicit pending_entity(std::size_t i)
+            : index(i) {}
+
+        std::size_t index;
+    };
+
+    basic_command_buffer() = default;
+
+    basic_command_buffer(const basic_command_buffer&) = delete;
+    basic_command_buffer& operator=(const basic_command_buffer&) = delete;
+
+    basic_command_buffer(basic_command_buffer&& other) = default;
+
+    basic_command_buffer& operator=(basic_command_buffer&& other) {
+        clear();
+        arena = std::move(other.arena);
+        created = std::move(other.created);
+        records = std::move(other.records);
+        destroyed = std::move(other.destroyed);
+        other.created.clear();
+        other.records.clear();
+        other.destroyed.clear();
+        return *this;
+    }
+
+    ~basic_command_buffer() {
+        clear();
+    }
+
+    /*! Records the creation of a new entity.
+     *
+     * @return Handle that can be used to add components to the entity before it exists.
+     */
+    pending_entity create_entity() {
+        created.push_back(current_batch());
+        return pending_entity{created.size() - 1};
+    }
+
+    /*! Records the destruction of an entity.
+     */
+    void destroy_entity(const ent_id& eid) {
+        destroyed.push_back({current_batch(), eid});
+    }
+
+    /*! Records adding a component to an existing entity.
+     */
+    template <typename T>
+    void add_component(const ent_id& eid, T&& com) {
+        record_add(existing(eid), std::forward<T>(com));
+    }
+
+    /*! Records adding a component to a pending entity.
+     */
+    template <typename T>
+    void add_component(pending_entity ent, T&& com) {
+        record_add(pending(ent), std::forward<T>(com));
+    }
+
+    /*! Records removing a component from an entity.
+     */
+    template <typename Com>
+    void remove_component(const ent_id& eid) {
+        records.push_back({get_type_guid<Com>(), current_batch(), existing(eid), make_command<remove_command<Com>>()});
+    }
+
+    /*! Whether no commands have been recorded.
+     */
+    bool empty() const {
+        return created.empty() && records.empty() && destroyed.empty();
+    }
+
+    /*! Discards all recorded commands.
+     */
+    void clear() {
+        for (auto& rec : records) {
+            rec.cmd->~command();
+        }
+        created.clear();
+        records.clear();
+        destroyed.clear();
+        arena.reset();
+    }
+
+private:
+    friend DB;
+
+    struct target {
+        typename ent_id::index_type index;
+        typename ent_id::version_type version;
+        bool is_pending;
+    };
+
+    struct command {
+        virtual ~command() = default;
+        virtual void apply(DB& db, const ent_id& eid) = 0;
+    };
+
+    template <typename T>
+    struct add_command final : command {
+        template <typename U>
+        explicit add_command(U&& c)
+            : com(std::forward<U>(c)) {}
+
+        virtual void apply(DB& db, const ent_id& eid) override {
+            db.add_component(eid, std::move(com));
+        }
+
+        T com;
+    };
+
+    template <typename Com>
+    struct remove_command final : command {
+        virtual void apply(DB& db, const ent_id& eid) override {
+            if (db.template has_component<Com>(eid)) {
+                db.template remove_component<Com>(eid);
+            }
+        }
+    };
+
+    /*! The thread pool run and task that recorded a command, used to merge buffers deterministically.
+     */
+    struct batch_id {
+        std::size_t pass;
+        std::size_t task;
+
+        bool operator<(const batch_id& other) const {
+            return pass < other.pass || (pass == other.pass && task < other.task);
+        }
+    };
+
+    struct record {
+        type_guid guid;
+        batch_id batch;
+        target tgt;
+        command* cmd;
+    };
+
+    struct destroy_record {
+        batch_id batch;
+        ent_id eid;
+    };
+
+    static batch_id current_batch() {
+        return {this_worker.pass, this_worker.task};
+    }
+
+    static target existing(const ent_id& eid) {
+        return {eid.index, eid.version, false};
+    }
+
+    static target pending(pending_entity ent) {
+        return {static_cast<typename ent_id::index_type>(ent.index), 0, true};
+    }
+
+    template <typename Command, typename... Args>
+    command* make_command(Args&&... args) {
+        auto mem = arena.allocate(sizeof(Command), alignof(Command));
+        return new (mem) Command(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    void record_add(target tgt, T&& com) {
+        using com_type = std::decay_t<T>;
+        records.push_back({get_type_guid<com_type>(), current_batch(), tgt, make_command<add_command<com_type>>(std::forward<T>(com))});
+    }
+
+    static ent_id resolve(const target& tgt, const std::vector<ent_id>& created_eids) {
+        if (tgt.is_pending) {
+            return created_eids[tgt.index];
+        } else {
+            return {tgt.index, tgt.version};
+        }
+    }
+
+    command_arena arena;
+    std::vector<batch_id> created;
+    std::vector<record> records;
+    std::vector<destroy_record> destroyed;
+};
+
+/*! Per-thread command buffers
+ *
+ * Holds one command buffer for each thread that `database::par_visit()` runs on,
+ * so that parallel visitors can record commands without locking.
+ *
+ * Playback merges the buffers in a fixed order: by the `par_visit()` call that recorded a command,
+ * then by the fixed-size chunk of entities that was being visited, and then by recording order.
+ * The outcome of playback, including the IDs given to created entities, therefore depends on neither thread scheduling
+ * nor the number of threads.
+ *
+ * Commands may also be recorded through `local()` on the thread that created the buffers, outside of `par_visit()`.
+ * They are ordered after the commands of the last `par_visit()` call on that thread.
+ */
+template <typename DB>
+class basic_thread_command_buffers {
+public:
+    using command_buffer = basic_command_buffer<DB>;
+
+    basic_thread_command_buffers()
+        : buffers(default_concurrency()), owner(std::this_thread::get_id()) {}
+
+    /*! The command buffer for the calling thread.
+     *
+     * @warning Only call this from inside `par_visit()`, or from the thread that created the buffers.
+     *          Any other thread would share the creating thread's buffer, which is checked with an assertion.
+     */
+    command_buffer& local() {
+        assert((this_worker.worker != 0 || std::this_thread::get_id() == owner) && "local() called from a thread outside the pool");
+        return buffers[this_worker.worker];
+    }
+
+    /*! Whether no commands have been recorded in any buffer.
+     */
+    bool empty() const {
+        return std::all_of(buffers.begin(), buffers.end(), [](const command_buffer& buf) { return buf.empty(); });
+    }
+
+    /*! Discards all recorded commands.
+     */
+    void clear() {
+        for (auto& buf : buffers) {
+            buf.clear();
+        }
+    }
+
+private:
+    friend DB;
+
+    std::vector<command_buffer> buffers;
+    std::thread::id owner;
+};
+
+template <typename Config>
+void basic_database<Config>::playback(command_buffer& commands) {
+    auto created = std::vector<ent_id>{};
+    auto buffer = &commands;
+    playback_helper(&buffer, 1, created);
+}
+
+template <typename Config>
+template <typename OutputIt>
+OutputIt basic_database<Config>::playback(command_buffer& commands, OutputIt created) {
+    auto created_eids = std::vector<ent_id>{};
+    auto buffer = &commands;
+    playback_helper(&buffer, 1, created_eids);
+    return std::copy(created_eids.begin(), created_eids.end(), created);
+}
+
+template <typename Config>
+void basic_database<Config>::playback(thread_command_buffers& commands) {
+    auto created = std::vector<ent_id>{};
+    auto buffers = std::vector<command_buffer*>{};
+    for (auto& buf : commands.buffers) {
+        buffers.push_back(&buf);
+    }
+    playback_helper(buffers.data(), buffers.size(), created);
+}
+
+template <typename Config>
+template <typename OutputIt>
+OutputIt basic_database<Config>::playback(thread_command_buffers& commands, OutputIt created) {
+    auto created_eids = std::vector<ent_id>{};
+    auto buffers = std::vector<command_buffer*>{};
+    for (auto& buf : commands.buffers) {
+        buffers.push_back(&buf);
+    }
+    playback_helper(buffers.data(), buffers.size(), created_eids);
+    return std::copy(created_eids.begin(), created_eids.end(), created);
+}
+
+template <typename Config>
+void basic_database<Config>::playback_helper(command_buffer* const* buffers, std::size_t num_buffers, std::vector<ent_id>& created) {
+    assert(!in_par_visit && "Commands cannot be played back during par_visit");
+
+    // Gathering in buffer order and then stable sorting by batch orders every kind of command by (batch, buffer, record).
+
+    struct pending_ref {
+        typename command_buffer::batch_id batch;
+        std::size_t buffer;
+        std::size_t index;
+    };
+
+    auto pending = std::vector<pending_ref>{};
+    for (auto b = std::size_t{0}; b < num_buffers; ++b) {
+        for (auto i = std::size_t{0}; i < buffers[b]->created.size(); ++i) {
+            pending.push_back({buffers[b]->created[i], b, i});
+        }
+    }
+    std::stable_sort(pending.begin(), pending.end(), [](const auto& a, const auto& b) {
+        return a.batch < b.batch;
+    });
+
+    created.reserve(pending.size());
+    create_entities(pending.size(), std::back_inserter(created));
+
+    auto buffer_created = std::vector<std::vector<ent_id>>(num_buffers);
+    for (auto b = std::size_t{0}; b < num_buffers; ++b) {
+        buffer_created[b].resize(buffers[b]->created.size(), ent_id{0, 0});
+    }
+    for (auto i = std::size_t{0}; i < pending.size(); ++i) {
+        buffer_created[pending[i].buffer][pending[i].index] = created[i];
+    }
+
+    struct record_ref {
+        const typename command_buffer::record* rec;
+        std::size_t buffer;
+    };
+
+    auto records = std::vector<record_ref>{};
+    for (auto b = std::size_t{0}; b < num_buffers; ++b) {
+        for (const auto& rec : buffers[b]->records) {
+            records.push_back({&rec, b});
+        }
+    }
+    std::stable_sort(records.begin(), records.end(), [](const auto& a, const auto& b) {
+        return a.rec->guid < b.rec->guid || (a.rec->guid == b.rec->guid && a.rec->batch < b.rec->batch);
+    });
+
+    for (auto& ref : records) {
+        auto eid = command_buffer::resolve(ref.rec->tgt, buffer_created[ref.buffer]);
+        if (exists(eid)) {
+            ref.rec->cmd->apply(*this, eid);
+        }
+    }
+
+    auto destroyed = std::vector<typename command_buffer::destroy_record>{};
+    for (auto b = std::size_t{0}; b < num_buffers; ++b) {
+        destroyed.insert(destroyed.end(), buffers[b]->destroyed.begin(), buffers[b]->destroyed.end());
+    }
+    std::stable_sort(destroyed.begin(), destroyed.end(), [](const auto& a, const auto& b) {
+        return a.batch < b.batch;
+    });
+
+    auto destroyed_eids = std::vector<ent_id>{};
+    destroyed_eids.reserve(destroyed.size());
+    for (const auto& rec : destroyed) {
+        destroyed_eids.push_back(rec.eid);
+    }
+    destroy_entities(destroyed_eids.begin(), destroyed_eids.end());
+
+    for (auto b = std::size_t{0}; b < num_buffers; ++b) {
+        buffers[b]->clear();
+    }
+}
+
+// Default Database
+
+/*! Database with the default configuration.
+ */
+using database = basic_database<default_config>;
+
+using command_buffer = database::command_buffer;
+using thread_command_buffers = database::thread_command_buffers;
+
+template <typename... Coms>
+using query = database::query<Coms...>;
+
+template <typename... Coms>
+using group = database::group<Coms...>;
+
+// Archetype Column Type
+
+/*! Type-erased operations on one component type, for archetype columns.
+ */
+struct column_type {
+    type_guid guid;
+    std::size_t size;
+    std::size_t align;
+
+    // Move-constructs the component at `dest` from the one at `src`, then destroys the one at `src`.
+    void (*relocate)(void* dest, void* src);
+    void (*destroy)(void* com);
+};
+
+template <typename T>
+const column_type& get_column_type() {
+    static const column_type type = {
+        get_type_guid<T>(),
+        sizeof(T),
+        alignof(T),
+        [](void* dest, void* src) {
+            auto& com = *static_cast<T*>(src);
+            new (dest) T(std::move(com));
+            com.~T();
+        },
+        [](void* com) { static_cast<T*>(com)->~T(); },
+    };
+    return type;
+}
+
+// Archetype
+
+/*! Table of all entities that have exactly the same signature.
+ *
+ * Rows are stored in fixed-size chunks. Each chunk holds one array per component column,
+ * so every column of a chunk is contiguous. Removing a row moves the last row into its place.
+ *
+ * Columns are sorted by type guid. Tags have no column.
+ */
+class archetype {
+public:
+    using size_type = std::size_t;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    // Target size of a chunk, in bytes.
+    static constexpr size_type chunk_bytes = 16 * 1024;
+
+    archetype(dynamic_bitset sig, std::vector<const column_type*> cols)
+        : signature(std::move(sig)), columns(std::move(cols)) {
+        auto row_bytes = size_type{0};
+        for (auto col : columns) {
+            row_bytes += col->size;
+            chunk_align = std::max(chunk_align, col->align);
+        }
+
+        rows_per_chunk = row_bytes == 0 ? chunk_bytes : std::max(size_type{1}, chunk_bytes / row_bytes);
+
+        for (auto col : columns) {
+            chunk_size = (chunk_size + col->align - 1) / col->align * col->align;
+            offsets.push_back(chunk_size);
+            chunk_size += col->size * rows_per_chunk;
+        }
+    }
+
+    archetype(const archetype&) = delete;
+    archetype& operator=(const archetype&) = delete;
+
+    ~archetype() {
+        for (auto row = size_type{0}; row < get_count(); ++row) {
+            for (auto c = size_type{0}; c < columns.size(); ++c) {
+                columns[c]->destroy(get(c, row));
+            }
+        }
+    }
+
+    const dynamic_bitset& get_signature() const {
+        return signature;
+    }
+
+    size_type get_count() const {
+        return entids.size();
+    }
+
+    size_type get_rows_per_chunk() const {
+        return rows_per_chunk;
+    }
+
+    /*! Number of chunks that hold at least one row.
+     */
+    size_type num_chunks() const {
+        return (get_count() + rows_per_chunk - 1) / rows_per_chunk;
+    }
+
+    size_type num_columns() const {
+        return columns.size();
+    }
+
+    /*! Index of the column that stores `guid`, or `npos`.
+     */
+    size_type find_column(type_guid guid) const {
+        auto iter = std::lower_bound(columns.begin(), columns.end(), guid, [](const column_type* col, type_guid g) {
+            return col->guid < g;
+        });
+        if (iter == columns.end() || (*iter)->guid != guid) {
+            return npos;
+        }
+        return iter - columns.begin();
+    }
+
+    const std::vector<const column_type*>& get_columns() const {
+        return columns;
+    }
+
+    /*! Address of the first component of column `col` in chunk `chunk`.
+     */
+    void* column_data(size_type col, size_type chunk) const {
+        return chunks[chunk].get() + offsets[col];
+    }
+
+    void* get(size_type col, size_type row) const {
+        return static_cast<unsigned char*>(column_data(col, row / rows_per_chunk)) + (row % rows_per_chunk) * columns[col]->size;
+    }
+
+    size_type get_entid(size_type row) const {
+        return entids[row];
+    }
+
+    /*! Adds a row for the entity, and returns its index.
+     *
+     * The row's components are not constructed.
+     */
+    size_type append(size_type entid) {
+        auto row = get_count();
+        if (!columns.empty() && row == chunks.size() * rows_per_chunk) {
+            chunks.emplace_back(static_cast<unsigned char*>(::operator new(chunk_size, std::align_val_t{chunk_align})), chunk_deleter{chunk_align});
+        }
+        entids.push_back(entid);
+        return row;
+    }
+
+    /*! Removes a row whose components have already been destroyed or moved out.
+     *
+     * Returns the entity that was moved into the row, or `npos` if the row was the last one.
+     */
+    size_type pop_row(size_type row) {
+        auto last = get_count() - 1;
+        auto moved = npos;
+
+        if (row != last) {
+            for (auto c = size_type{0}; c < columns.size(); ++c) {
+                columns[c]->relocate(get(c, row), get(c, last));
+            }
+            moved = entids[last];
+            entids[row] = moved;
+        }
+
+        entids.pop_back();
+        return moved;
+    }
+
+    /*! Cached archetype for this signature with `guid` added.
+     */
+    archetype*& add_edge(type_guid guid) {
+        return get_edge(add_edges, guid);
+    }
+
+    /*! Cached archetype for this signature with `guid` removed.
+     */
+    archetype*& remove_edge(type_guid guid) {
+        return get_edge(remove_edges, guid);
+    }
+
+private:
+    struct chunk_deleter {
+        size_type align;
+
+        void operator()(unsigned char* chunk) const {
+            ::operator delete(chunk, std::align_val_t{align});
+        }
+    };
+
+    static archetype*& get_edge(std::vector<archetype*>& edges, type_guid guid) {
+        if (guid >= edges.size()) {
+            edges.resize(guid + 1);
+        }
+        return edges[guid];
+    }
+
+    dynamic_bitset signature;
+    std::vector<const column_type*> columns;
+    std::vector<size_type> offsets;
+    size_type rows_per_chunk = 0;
+    size_type chunk_size = 0;
+    size_type chunk_align = alignof(std::max_align_t);
+    std::vector<std::unique_ptr<unsigned char, chunk_deleter>> chunks;
+    std::vector<size_type> entids;
+    std::vector<archetype*> add_edges;
+    std::vector<archetype*> remove_edges;
+};
+
+// Archetype Visitor Traits
+
+/*! Resolves a visitor's parameters once per archetype, then calls it for every row.
+ */
+template <typename... Components>
+class archetype_visitor_traits {
+public:
+    template <typename DB, typename Visitor>
+    void apply(DB& db, const archetype& arch, Visitor& visitor) const {
+        if (arch.get_count() != 0 && key.matches(arch.get_signature())) {
+            apply_rows(db, arch, visitor, std::index_sequence_for<Components...>{});
+        }
+    }
+
+private:
+    using db_traits = database_traits<database>;
+
+    template <typename Com>
+    using tag_t = typename db_traits::template component_traits<Com>::category;
+
+    template <typename Com>
+    using com_t = typename db_traits::template component_traits<Com>::component;
+
+    template <typename DB, typename Visitor, std::size_t... Is>
+    void apply_rows(DB& db, const archetype& arch, Visitor& visitor, std::index_sequence<Is...>) const {
+        [[maybe_unused]] auto columns = std::array<archetype::size_type, sizeof...(Components)>{find_column<Components>(arch)...};
+        auto rows_per_chunk = arch.get_rows_per_chunk();
+
+        // Back to front, so the visitor may destroy the entity it was given.
+        for (auto chunk = arch.num_chunks(); chunk > 0;) {
+            --chunk;
+
+            [[maybe_unused]] auto bases = std::array<void*, sizeof...(Components)>{column_base(arch, columns[Is], chunk)...};
+            auto first = chunk * rows_per_chunk;
+
+            for (auto row = std::min(first + rows_per_chunk, arch.get_count()); row > first;) {
+                --row;
+                if (row < arch.get_count()) {
+                    visitor(get_com<Components>(tag_t<Components>{}, db, arch, bases[Is], row, row - first)...);
+                }
+            }
+        }
+    }
+
+    template <typename Com>
+    static archetype::size_type find_column(const archetype& arch) {
+        if constexpr (std::is_same_v<tag_t<Com>, component_tags::normal> || std::is_same_v<tag_t<Com>, component_tags::optional>) {
+            return arch.find_column(get_type_guid<com_t<Com>>());
+        } else {
+            return archetype::npos;
+        }
+    }
+
+    static void* column_base(const archetype& arch, archetype::size_type col, archetype::size_type chunk) {
+        return col == archetype::npos ? nullptr : arch.column_data(col, chunk);
+    }
+
+    template <typename Com, typename DB>
+    static Com& get_com(component_tags::normal, DB&, const archetype&, void* base, std::size_t, std::size_t offset) {
+        return static_cast<Com*>(base)[offset];
+    }
+
+    template <typename Com, typename DB>
+    static Com get_com(component_tags::optional, DB&, const archetype& arch, void* base, std::size_t, std::size_t offset) {
+        using inner_component = com_t<Com>;
+        if constexpr (std::is_same_v<tag_t<inner_component>, component_tags::tagged>) {
+            return Com(arch.get_signature().get(get_type_guid<inner_component>()));
+        } else {
+            return base ? Com(static_cast<inner_component*>(base)[offset]) : Com();
+        }
+    }
+
+    template <typename Com, typename DB>
+    static auto get_com(component_tags::eid, DB& db, const archetype& arch, void*, std::size_t row, std::size_t) {
+        return db.get_ent_id(arch.get_entid(row));
+    }
+
+    template <typename Com, typename DB>
+    static Com get_com(component_tags::unit, DB&, const archetype&, void*, std::size_t, std::size_t) {
+        return {};
+    }
+
+    typename db_traits::template visitor_key<Components...> key;
+};
+
+/*! Archetype Database
+ *
+ * An alternative to `database` that stores each combination of components in its own table (an archetype),
+ * instead of storing each component type in its own set.
+ *
+ * Visitors read every component of an entity from the same row, without any per-entity lookups,
+ * but adding or removing a component moves all of the entity's components to another table.
+ *
+ * Uses the same `ent_id` and visitor parameter grammar as `database`.
+ */
+class archetype_database {
+public:
+    using ent_id = database::ent_id;
+    using size_type = archetype::size_type;
+
+    archetype_database() {
+        auto sig = dynamic_bitset{};
+        sig.set(0);
+        archetypes.push_back(std::make_unique<archetype>(std::move(sig), std::vector<const column_type*>{}));
+    }
+
+    archetype_database(const archetype_database&) = delete;
+    archetype_database& operator=(const archetype_database&) = delete;
+
+    /*! Creates a new Entity that has no components.
+     *
+     * @return ID of the new Entity.
+     */
+    ent_id create_entity() {
+        ent_id::index_type index;
+
+        if (free_entities.empty()) {
+            index = entities.size();
+            entities.emplace_back();
+        } else {
+            index = free_entities.back();
+            free_entities.pop_back();
+        }
+
+        auto& root = *archetypes.front();
+        entities[index].arch = &root;
+        entities[index].row = root.append(index);
+
+        return {index, entities[index].version};
+    }
+
+    /*! Destroys an Entity and all of its components.
+     *
+     * If the Entity does not exist, no work is done.
+     *
+     * @param eid ID of the Entity to destroy.
+     */
+    void destroy_entity(const ent_id& eid) {
+        const auto index = eid.get_index();
+        auto& rec = entities[index];
+
+        if (rec.version != eid.version || !rec.arch) {
+            return;
+        }
+
+        auto& arch = *rec.arch;
+        for (auto c = size_type{0}; c < arch.num_columns(); ++c) {
+            arch.get_columns()[c]->destroy(arch.get(c, rec.row));
+        }
+        remove_row(arch, rec.row);
+
+        rec.arch = nullptr;
+        ++rec.version;
+        free_entities.push_back(index);
+    }
+
+    /*! Determines whether or not an entity exists.
+     *
+     * @param eid ID of the Entity to check.
+     */
+    bool exists(const ent_id& eid) const {
+        return entities[eid.index].version == eid.version && entities[eid.index].arch;
+    }
+
+    /*! Adds a component to an entity.
+     *
+     * If a component of the same type already exists for this entity,
+     * the given component will be forward-assigned to it.
+     *
+     * Otherwise, moves the entity to the archetype that also has this component.
+     *
+     * @param eid Entity to attach new component to.
+     * @param com Component value.
+     */
+    template <typename T>
+    void add_component(const ent_id& eid, T&& com) {
+        using com_type = std::decay_t<T>;
+
+        auto index = eid.get_index();
+        auto guid = get_type_guid<com_type>();
+        auto& src = *entities[index].arch;
+
+        if (auto col = src.find_column(guid); col != archetype::npos) {
+            *static_cast<com_type*>(src.get(col, entities[index].row)) = std::forward<T>(com);
+            return;
+        }
+
+        auto& dest = get_add_target(src, guid, &get_column_type<com_type>());
+        auto row = dest.append(index);
+
+        // The new component is built before the entity moves, so a throwing constructor leaves the entity where it was.
+        try {
+            new (dest.get(dest.find_column(guid), row)) com_type(std::forward<T>(com));
+        } catch (...) {
+            dest.pop_row(row);
+            throw;
+        }
+
+        move_entity(index, dest, row);
+    }
+
+    /*! Adds a Tag component to an entity, if it does not already exist.
+     *
+     * @param eid Entity to attach new Tag component to.
+     */
+    template <typename T>
+    void add_component(const ent_id& eid, tag<T>) {
+        auto index = eid.get_index();
+        auto guid = get_type_guid<tag<T>>();
+        auto& src = *entities[index].arch;
+
+        if (!src.get_signature().get(guid)) {
+            move_entity(index, get_add_target(src, guid, nullptr));
+        }
+    }
+
+    template <typename T>
+    void add_component(const ent_id& eid, require<T> com) = delete;
+
+    template <typename T>
+    void add_component(const ent_id& eid, deny<T> com) = delete;
+
+    template <typename T>
+    void add_component(const ent_id& eid, optional<T> com) = delete;
+
+    template <typename T>
+    void add_component(const ent_id& eid, ent_id com) = delete;
+
+    /*! Removes a component from an entity and destroys it.
+     *
+     * If the entity does not exist or does not have the component, no work is done.
+     *
+     * @tparam Com Type of the component to remove.
+     * @param eid ID of the entity.
+     */
+    template <typename Com>
+    void remove_component(const ent_id& eid) {
+        if (!has_component<Com>(eid)) {
+            return;
+        }
+
+        auto index = eid.get_index();
+        auto& src = *entities[index].arch;
+        move_entity(index, get_remove_target(src, get_type_guid<Com>()));
+    }
+
+    /*! Get a component.
+     *
+     * If Com is a non-pointer type, returns a reference to the component without checking that it exists.
+     *
+     * Otherwise, if Com is a pointer type, returns a pointer to the component of the pointed-to type,
+     * or nullptr if the entity does not exist or does not have one.
+     *
+     * @tparam Com Type of the component to get.
+     * @param eid ID of the entity.
+     * @return Either a reference to the component, or a pointer to the component, or nullptr.
+     */
+    template <typename Com>
+    auto get_component(const ent_id& eid) -> std::conditional_t<std::is_pointer_v<Com>, Com, Com&> {
+        using component_t = std::remove_pointer_t<Com>;
+
+        const auto& rec = entities[eid.index];
+
+        if constexpr (std::is_pointer_v<Com>) {
+            if (rec.version != eid.version || !rec.arch) {
+                return nullptr;
+            }
+
+            auto col = rec.arch->find_column(get_type_guid<component_t>());
+            return col == archetype::npos ? nullptr : static_cast<component_t*>(rec.arch->get(col, rec.row));
+        } else {
+            auto col = rec.arch->find_column(get_type_guid<component_t>());
+            return *static_cast<component_t*>(rec.arch->get(col, rec.row));
+        }
+    }
+
+    /*! Checks if an entity has a component.
+     *
+     * If the entity does not exist, returns false.
+     *
+     * @tparam Com Type of the component to check.
+     * @param eid ID of the entity.
+     */
+    template <typename Com>
+    bool has_component(const ent_id& eid) const {
+        const auto& rec = entities[eid.index];
+        return rec.version == eid.version && rec.arch && rec.arch->get_signature().get(get_type_guid<Com>());
+    }
+
+    /*! Visit the Database.
+     *
+     * Accepts the same visitors as `database::visit()`.
+     * The parameters are matched against each archetype's signature once,
+     * then the visitor is called for every entity in the matching archetypes.
+     *
+     * @warning The visitor may destroy the entity it was given. Other changes to entities or components during the visit
+     *          could cause entities to be skipped or visited twice.
+     *
+     * @tparam Visitor Visitor function type.
+     * @param visitor Visitor function.
+     */
+    template <typename Visitor>
+    void visit(Visitor&& visitor) {
+        using visitor_traits = typename database_traits<database>::template visitor_traits<Visitor>;
+        using archetype_traits = typename visitor_traits::template rebind_t<archetype_visitor_traits>;
+
+        auto traits = archetype_traits{};
+
+        for (auto a = size_type{0}; a < archetypes.size(); ++a) {
+            traits.apply(*this, *archetypes[a], visitor);
+        }
+    }
+
+    /*! Visit the chunks of every matching archetype.
+     *
+     * Accepts the same visitors as `database::visit_chunks()`, except that any number of component types may be loaded.
+     * The visitor is called once per chunk, with spans covering every entity in the chunk.
+     *
+     * @warning Creating or destroying entities and adding or removing components is not allowed during the visit.
+     *
+     * @tparam Visitor Visitor function type.
+     * @param visitor Visitor function.
+     */
+    template <typename Visitor>
+    void visit_chunks(Visitor&& visitor) {
+        using db_traits = database_traits<database>;
+        using visitor_traits = typename db_traits::template visitor_traits<Visitor>;
+        using chunk_traits = typename visitor_traits::template rebind_t<db_traits::chunk_visitor_traits_impl>;
+
+        auto traits = chunk_traits{};
+        auto eids = std::vector<ent_id>{};
+
+        for (const auto& arch : archetypes) {
+            if (arch->get_count() == 0 || !traits.matches(arch->get_signature())) {
+                continue;
+            }
+
+            auto rows_per_chunk = arch->get_rows_per_chunk();
+
+            for (auto chunk = size_type{0}, n = arch->num_chunks(); chunk < n; ++chunk) {
+                auto first = chunk * rows_per_chunk;
+                auto size = std::min(rows_per_chunk, arch->get_count() - first);
+
+                traits.apply(visitor, size, [&](auto column) {
+                    using component_t = typename decltype(column)::type;
+                    if constexpr (std::is_same_v<component_t, ent_id>) {
+                        eids.clear();
+                        for (auto row = first; row < first + size; ++row) {
+                            eids.push_back(get_ent_id(arch->get_entid(row)));
+                        }
+                        return static_cast<const ent_id*>(eids.data());
+                    } else {
+                        return static_cast<component_t*>(arch->column_data(arch->find_column(get_type_guid<component_t>()), chunk));
+                    }
+                });
+            }
+        }
+    }
+
+    /*! Get the number of entities in the Database.
+     */
+    auto size() const {
+        return entities.size() - free_entities.size();
+    }
+
+    /*! Get the number of components of a certain type in the Database.
+     */
+    template <typename Com>
+    size_type count() const {
+        auto guid = get_type_guid<Com>();
+        auto total = size_type{0};
+        for (const auto& arch : archetypes) {
+            if (arch->get_signature().get(guid)) {
+                total += arch->get_count();
+            }
+        }
+        return total;
+    }
+
+    /*! Get the number of distinct archetypes that have been created.
+     */
+    size_type num_archetypes() const {
+        return archetypes.size();
+    }
+
+private:
+    template <typename...>
+    friend class archetype_visitor_traits;
+
+    struct entity_record {
+        archetype* arch = nullptr;
+        size_type row = 0;
+        ent_id::version_type version = 0;
+    };
+
+    ent_id get_ent_id(size_type index) const {
+        return {index, entities[index].version};
+    }
+
+    void remove_row(archetype& arch, size_type row) {
+        auto moved = arch.pop_row(row);
+        if (moved != archetype::npos) {
+            entities[moved].row = row;
+        }
+    }
+
+    /*! Moves an entity to `dest`, relocating the components both archetypes store.
+     *
+     * Components that `dest` does not store are destroyed. Components that only `dest` stores are left unconstructed.
+     *
+     * @return The entity's new row.
+     */
+    size_type move_entity(ent_id::index_type index, archetype& dest) {
+        auto row = dest.append(index);
+        move_entity(index, dest, row);
+        return row;
+    }
+
+    /*! Moves an entity to `row` of `dest`, which has already been appended for it.
+     */
+    void move_entity(ent_id::index_type index, archetype& dest, size_type row) {
+        auto& rec = entities[index];
+        auto& src = *rec.arch;
+
+        const auto& src_cols = src.get_columns();
+        for (auto c = size_type{0}; c < src_cols.size(); ++c) {
+            auto d = dest.find_column(src_cols[c]->guid);
+            if (d != archetype::npos) {
+                src_cols[c]->relocate(dest.get(d, row), src.get(c, rec.row));
+            } else {
+                src_cols[c]->destroy(src.get(c, rec.row));
+            }
+        }
+
+        remove_row(src, rec.row);
+
+        rec.arch = &dest;
+        rec.row = row;
+    }
+
+    archetype& get_add_target(archetype& src, type_guid guid, const column_type* col) {
+        auto& edge = src.add_edge(guid);
+        if (!edge) {
+            auto sig = copy_signature(src.get_signature());
+            sig.set(guid);
+
+            auto cols = src.get_columns();
+            if (col) {
+                cols.insert(std::upper_bound(cols.begin(), cols.end(), col, [](const column_type* a, const column_type* b) {
+                    return a->guid < b->guid;
+                }), col);
+            }
+
+            edge = &find_or_create_archetype(std::move(sig), std::move(cols));
+            edge->remove_edge(guid) = &src;
+        }
+        return *edge;
+    }
+
+    archetype& get_remove_target(archetype& src, type_guid guid) {
+        auto& edge = src.remove_edge(guid);
+        if (!edge) {
+            auto sig = copy_signature(src.get_signature());
+            sig.unset(guid);
+
+            auto cols = src.get_columns();
+            cols.erase(std::remove_if(cols.begin(), cols.end(), [&](const column_type* c) { return c->guid == guid; }), cols.end());
 
-    operator Index() const {
-        return index;
+            edge = &find_or_create_archetype(std::move(sig), std::move(cols));
+            edge->add_edge(guid) = &src;
+        }
+        return *edge;
     }
 
-    opaque_index& operator++() {
-        ++index;
-        return *this;
+    // Only runs when an edge is missing, so a linear search is fine.
+    archetype& find_or_create_archetype(dynamic_bitset sig, std::vector<const column_type*> cols) {
+        for (auto& arch : archetypes) {
+            const auto& other = arch->get_signature();
+            if (other.contains_all(sig) && sig.contains_all(other)) {
+                return *arch;
+            }
+        }
+        archetypes.push_back(std::make_unique<archetype>(std::move(sig), std::move(cols)));
+        return *archetypes.back();
     }
 
-    Index index;
+    static dynamic_bitset copy_signature(const dynamic_bitset& sig) {
+        auto copy = dynamic_bitset{};
+        for (auto i = sig.find_next(0); i < sig.size(); i = sig.find_next(i + 1)) {
+            copy.set(i);
+        }
+        return copy;
+    }
+
+    std::vector<entity_record> entities;
+    std::vector<ent_id::index_type> free_entities;
+    std::vector<std::unique_ptr<archetype>> archetypes;
 };
 
-/*! Database
+// Static Database
+
+/*! Static Database
  *
- * An Entity component Database. Uses the given allocator to allocate
- * components, and may also use the same allocator for internal data.
+ * An alternative to `database` for programs that know every component type up front.
  *
- * @warning
- * This container does not perform any synchronization. Therefore, it is not
- * considered "thread-safe".
+ * Each type in `Coms` has a fixed index, so finding its storage needs no type guid lookup,
+ * and the component sets are stored directly in the database instead of behind pointers.
+ * Signatures are fixed-size bitsets, and the masks that visitors match against are built at compile time.
+ *
+ * Uses the same `ent_id`, storage policies, and visitor parameter grammar as `database`.
+ * Tag components must be listed too, as `tag<T>`.
+ *
+ * @tparam Coms Every component type that the database can store.
  */
-class database {
+template <typename... Coms>
+class static_database {
 public:
-    // IDs
+    using ent_id = database::ent_id;
+    using size_type = std::size_t;
 
-    /*! Entity ID.
+    /*! Whether `Com` is one of the database's component types.
      */
-    class ent_id {
-    public:
-        friend class database;
-        using index_type = std::vector<entity>::size_type;
-        using version_type = entity::version_type;
-
-        bool operator==(const ent_id& other) const {
-            return index == other.index && version == other.version;
-        }
-
-        index_type get_index() const {
-            return index;
-        }
+    template <typename Com>
+    static constexpr bool has_type = (std::is_same_v<Com, Coms> || ...);
 
-    private:
-        ent_id(index_type i, version_type v)
-            : index(i), version(v) {}
+    static_database() = default;
 
-        index_type index = 0;
-        version_type version = 0;
-    };
+    static_database(const static_database&) = delete;
+    static_database& operator=(const static_database&) = delete;
 
-    /*! Component ID.
-     */
-    using com_id = opaque_index<struct com_id_tag, database, component_set::size_type>;
+    static_database(static_database&&) = default;
+    static_database& operator=(static_database&&) = default;
 
-    /*! Creates a new Entity.
-     *
-     * Creates a new Entity that has no components.
+    /*! Creates a new Entity that has no components.
      *
      * @return ID of the new Entity.
      */
@@ -753,41 +5326,36 @@ public:
         ent_id::index_type index;
 
         if (free_entities.empty()) {
-            index = entities.size();
-            entities.emplace_back();
+            index = signatures.size();
+            signatures.emplace_back();
+            versions.push_back(0);
         } else {
             index = free_entities.back();
             free_entities.pop_back();
         }
 
-        entities[index].components.set(0);
+        signatures[index].set(0);
 
-        return {index, entities[index].version};
+        return {index, versions[index]};
     }
 
-    /*! Destroys an Entity.
-     *
-     * Destroys the given Entity and all associated components.
+    /*! Destroys an Entity and all of its components.
      *
      * If the Entity does not exist, no work is done.
      *
-     * @param eid ID of the Entity to erase.
+     * @param eid ID of the Entity to destroy.
      */
     void destroy_entity(const ent_id& eid) {
         const auto index = eid.get_index();
 
-        if (entities[index].version != eid.version) {
+        if (versions[index] != eid.version) {
             return;
         }
 
-        for (dynamic_bitset::size_type i = 1; i < entities[index].components.size(); ++i) {
-            if (entities[index].components.get(i)) {
-                component_sets[i]->remove(index);
-            }
-        }
+        (remove_from_set<Coms>(index), ...);
 
-        entities[index].components.zero();
-        ++entities[index].version;
+        signatures[index] = {};
+        ++versions[index];
         free_entities.push_back(index);
     }
 
@@ -796,7 +5364,7 @@ public:
      * @param eid ID of the Entity to check.
      */
     bool exists(const ent_id& eid) const {
-        return entities[eid.index].version == eid.version && entities[eid.index].components.get(0);
+        return versions[eid.index] == eid.version && signatures[eid.index].get(0);
     }
 
     /*! Adds a component to an entity.
@@ -804,375 +5372,306 @@ public:
      * If a component of the same type already exists for this entity,
      * the given component will be forward-assigned to it.
      *
-     * Otherwise, moves or copies the given component and adds it to the entity.
-     *
      * @param eid Entity to attach new component to.
      * @param com Component value.
-     * @return ID of component.
      */
     template <typename T>
-    com_id add_component(const ent_id& eid, T&& com) {
+    void add_component(const ent_id& eid, T&& com) {
         using com_type = std::decay_t<T>;
-        auto index = eid.get_index();
-        auto guid = get_type_guid<com_type>();
-        auto& ent_coms = entities[index].components;
-        auto& com_set = get_or_create_com_set<com_type>();
 
-        com_id cid;
+        auto index = eid.get_index();
+        auto& com_set = get_set<com_type>();
+        constexpr auto bit = bit_of<com_type>();
 
-        if (guid < ent_coms.size() && ent_coms.get(guid)) {
-            cid = com_set.get_comid(index);
-            com_set.get_com(cid) = std::forward<T>(com);
+        if (signatures[index].get(bit)) {
+            com_set.get_com(com_set.get_comid(index)) = std::forward<T>(com);
         } else {
-            cid = com_set.assign(index, std::forward<T>(com));
-            ent_coms.set(guid);
+            com_set.assign(index, std::forward<T>(com));
+            signatures[index].set(bit);
         }
-
-        return cid;
     }
 
-    /*! Create new Tag component.
-     *
-     * Adds the tag to the entity if it does not already exist.
+    /*! Adds a Tag component to an entity, if it does not already exist.
      *
      * @param eid Entity to attach new Tag component to.
-     * @param com Tag value.
      */
     template <typename T>
-    void add_component(ent_id eid, tag<T>) {
-        auto index = eid.get_index();
-        auto guid = get_type_guid<tag<T>>();
-        auto& ent_coms = entities[index].components;
-
-        get_or_create_com_set<tag<T>>();
-
-        ent_coms.set(guid);
+    void add_component(const ent_id& eid, tag<T>) {
+        signatures[eid.get_index()].set(bit_of<tag<T>>());
     }
 
     template <typename T>
-    void add_component(ent_id eid, require<T> com) = delete;
+    void add_component(const ent_id& eid, require<T> com) = delete;
 
     template <typename T>
-    void add_component(ent_id eid, deny<T> com) = delete;
+    void add_component(const ent_id& eid, deny<T> com) = delete;
 
     template <typename T>
-    void add_component(ent_id eid, optional<T> com) = delete;
+    void add_component(const ent_id& eid, optional<T> com) = delete;
 
     template <typename T>
-    void add_component(ent_id eid, ent_id com) = delete;
+    void add_component(const ent_id& eid, ent_id com) = delete;
 
-    /*! Remove a component from an entity.
-     *
-     * Removes the component from the entity and destroys it.
-     *
-     * If the entity does not exist, no work is done.
-     *
-     * @warning
-     * All ComIDs associated with the removed component will be invalidated.
+    /*! Removes a component from an entity and destroys it.
      *
-     * @tparam Com Type of the component to erase.
+     * If the entity does not exist or does not have the component, no work is done.
      *
+     * @tparam Com Type of the component to remove.
      * @param eid ID of the entity.
      */
     template <typename Com>
-    void remove_component(ent_id eid) {
-        auto index = eid.get_index();
-
-        if (entities[index].version != eid.version) {
-            return;
+    void remove_component(const ent_id& eid) {
+        if (has_component<Com>(eid)) {
+            remove_from_set<Com>(eid.get_index());
+            signatures[eid.get_index()].unset(bit_of<Com>());
         }
-
-        auto guid = get_type_guid<Com>();
-        auto& com_set = *get_com_set<Com>();
-        com_set.remove(index);
-        entities[index].components.unset(guid);
     }
 
     /*! Get a component.
      *
-     * If Com is a non-pointer type, returns a reference to the component without performing safe checks for existence.
-     *
-     * Otherwise, if Com is a pointer type,
-     * returns a pointer to the component of the pointed-to type that is associated with the given entity.
-     *
-     * If the entity has no associated component of the given type, returns nullptr.
+     * If Com is a non-pointer type, returns a reference to the component (a `soa_ref` for field-split components)
+     * without checking that it exists.
      *
-     * If the entity does not exist, returns nullptr.
+     * Otherwise, if Com is a pointer type, returns a pointer to the component of the pointed-to type,
+     * or nullptr if the entity does not exist or does not have one.
      *
      * @tparam Com Type of the component to get.
-     *
      * @param eid ID of the entity.
      * @return Either a reference to the component, or a pointer to the component, or nullptr.
      */
     template <typename Com>
-    auto get_component(ent_id eid) -> std::conditional_t<std::is_pointer_v<Com>, Com, Com&> {
-        auto index = eid.index;
-
+    auto get_component(const ent_id& eid) -> std::conditional_t<std::is_pointer_v<Com>, Com, component_reference_t<Com>> {
         if constexpr (std::is_pointer_v<Com>) {
             using component_t = std::remove_pointer_t<Com>;
+            static_assert(!is_field_split_v<component_t>, "Field-split components have no address; use get_component<T>()");
 
-            if (entities[index].version != eid.version) {
+            if (!has_component<component_t>(eid)) {
                 return nullptr;
             }
 
-            auto guid = get_type_guid<component_t>();
-
-            if (has_component<component_t>(eid, guid)) {
-                auto& com_set = *get_com_set<component_t>(guid);
-                auto cid = com_set.get_comid(index);
-                return &com_set.get_com(cid);
-            } else {
-                return nullptr;
-            }
+            auto& com_set = get_set<component_t>();
+            return &com_set.get_com(com_set.get_comid(eid.get_index()));
         } else {
-            auto& com_set = *get_com_set<Com>();
-            auto cid = com_set.get_comid(index);
-            return com_set.get_com(cid);
+            auto& com_set = get_set<Com>();
+            return com_set.get_com(com_set.get_comid(eid.get_index()));
         }
     }
 
-    /*! Get a component by its ID.
-     *
-     * Gets a reference to the component of the given type that has the given ID.
-     *
-     * @warning
-     * Behavior is undefined when no component is associated with the given ID.
-     *
-     * @tparam Com Type of the component to get.
-     *
-     * @param cid ID of the component.
-     * @return Reference to the component.
-     */
-    template <typename Com>
-    Com& get_component_by_id(com_id cid) {
-        auto& com_set = *get_com_set<Com>();
-        return com_set.get_com(cid);
-    }
-
     /*! Checks if an entity has a component.
-     *
-     * Returns whether or not the entity has a component of the
-     * associated type.
      *
      * If the entity does not exist, returns false.
      *
      * @tparam Com Type of the component to check.
-     *
      * @param eid ID of the entity.
-     * @return True if the component exists.
      */
     template <typename Com>
-    bool has_component(ent_id eid) {
-        auto index = eid.get_index();
-
-        if (entities[index].version != eid.version) {
-            return false;
-        }
-
-        return has_component<Com>(eid, get_type_guid<Com>());
+    bool has_component(const ent_id& eid) const {
+        return versions[eid.index] == eid.version && signatures[eid.index].get(bit_of<Com>());
     }
 
     /*! Visit the Database.
      *
-     * Visit the Entities in the Database that match the given function's parameter types.
-     *
-     * The following parameter categories are accepted:
-     *
-     * - `T`, matches entities that have component `T`, and loads the component.
-     * - `tag<T>`, matches entities that have component `tag<T>`.
-     * - `require<T>`, matches entities that have component `T`, but does not load it.
-     * - `optional<T>`, matches all entities, loads component `T` if it exists.
-     * - `deny<T>`, matches entities that do *not* match component `T`.
-     * - `ent_id`, matches all entities, provides the `ent_id` of the current entity.
-     *
-     * `T` and `optional<T>` parameters will refer to the entity's matching component.
-     * `ent_id` parameters will contain the entity's `ent_id`.
-     * Other parameters will be their default value.
-     *
-     * Entities that do not match all given parameter conditions will be skipped.
-     *
-     * @warning Entities are visited in no particular order, so creating and destroying
-     *          entities or adding or removing components from within the visitor
-     *          could result in weird behavior.
+     * Accepts the same visitors as `database::visit()`, and follows the same rules.
+     * Every parameter type must be one of the database's component types, or `ent_id`.
      *
      * @tparam Visitor Visitor function type.
      * @param visitor Visitor function.
      */
     template <typename Visitor>
     void visit(Visitor&& visitor) {
-        using db_traits = database_traits<database>;
-        using traits = typename db_traits::visitor_traits<Visitor>;
-        using primary_component = typename traits::primary_component;
+        using visitor_traits = typename database_traits<database>::template visitor_traits<Visitor>;
+        using static_traits = typename visitor_traits::template rebind_t<static_visitor_traits>;
+        using primary_candidates = typename visitor_traits::primary_candidates;
 
-        return visit_helper(std::forward<Visitor>(visitor), primary_component{});
+        with_smallest_primary(primary_candidates{}, [&](auto prim) {
+            static_traits::visit(*this, visitor, prim);
+        });
     }
 
     /*! Get the number of entities in the Database.
-     *
-     * @return Number of entities in the Database.
      */
     auto size() const {
-        return entities.size() - free_entities.size();
+        return signatures.size() - free_entities.size();
     }
 
     /*! Get the number of components of a certain type in the Database.
-     *
-     * @return Number of components of type Com.
      */
     template <typename Com>
-    component_set::size_type count() const {
-        if (auto set = get_com_set<Com>()) {
-            return set->get_count();
+    size_type count() const {
+        if constexpr (std::is_same_v<storage_policy_t<Com>, tag_storage>) {
+            return std::count_if(signatures.begin(), signatures.end(), [](const signature_type& sig) { return sig.get(bit_of<Com>()); });
         } else {
-            return 0;
+            return get_set<Com>().get_count();
         }
     }
 
-    /*! Converts an ent_id to a void* for storage purposes.
-     *
-     * @warning This is not a valid pointer and relies on widespread compiler-specific behavior.
-     *          Do not ever dereference the pointer.
-     *          Entity version checking is not preserved through conversion to and from pointers.
-     *          Null pointers are a valid result.
-     *
-     * @param eid Entity ID to convert to a pointer.
-     * @return A pointer which may be converted back into the same ID using from_ptr(ptr).
-     */
-    auto to_ptr(const ent_id& eid) const -> void* {
-        static_assert(sizeof(void*) >= sizeof(ent_id::index_type), "Pointer conversion not possible");
-        return reinterpret_cast<void*>(eid.get_index());
-    }
-
-    /*! Converts a void* to an ent_id. The pointer must have been returned from to_ptr(eid).
-     *
-     * @warning The entity must not have been deleted. Version checking is not applied.
-     *
-     * @param ptr Pointer which was obtained from to_ptr(eid).
-     * @return The original ent_id that was passed to to_ptr(eid).
-     */
-    auto from_ptr(void* ptr) const -> ent_id {
-        auto i = reinterpret_cast<ent_id::index_type>(ptr);
-        return ent_id{i, entities[i].version};
-    }
-
 private:
-    friend struct database_traits<database>;
+    using signature_type = fixed_bitset<sizeof...(Coms) + 1>;
 
     template <typename Com>
-    Com& get_component(ent_id eid, type_guid guid) {
-        auto& com_set = *unsafe_get_com_set<Com>(guid);
-        auto cid = com_set.get_comid(eid.get_index());
-        return com_set.get_com(cid);
-    }
+    using com_set_t = component_set_impl<Com, ent_id::index_type>;
 
+    /*! Signature bit of `Com`. Bit 0 means that the entity exists.
+     */
     template <typename Com>
-    Com& get_component_by_id(com_id cid, type_guid guid) {
-        auto& com_set = *unsafe_get_com_set<Com>(guid);
-        return com_set.get_com(cid);
+    static constexpr size_type bit_of() {
+        static_assert(has_type<Com>, "Component type is not one of the static_database's types");
+        if constexpr (has_type<Com>) {
+            return index_of_v<Com, Coms...> + 1;
+        } else {
+            return 0;
+        }
     }
 
     template <typename Com>
-    bool has_component(ent_id eid, type_guid guid) {
-        auto& ent_coms = entities[eid.get_index()].components;
-        return ent_coms.get(guid);
+    com_set_t<Com>& get_set() {
+        return std::get<bit_of<Com>() - 1>(sets);
     }
 
     template <typename Com>
-    component_set_impl<Com>* get_com_set() {
-        return get_com_set<Com>(get_type_guid<Com>());
+    const com_set_t<Com>& get_set() const {
+        return std::get<bit_of<Com>() - 1>(sets);
     }
 
     template <typename Com>
-    const component_set_impl<Com>* get_com_set() const {
-        return get_com_set<Com>(get_type_guid<Com>());
+    void remove_from_set(size_type index) {
+        if constexpr (!std::is_same_v<storage_policy_t<Com>, tag_storage>) {
+            if (signatures[index].get(bit_of<Com>())) {
+                get_set<Com>().remove(index);
+            }
+        }
     }
 
-    template <typename Com>
-    component_set_impl<Com>* get_com_set(type_guid guid) {
-        if (guid >= component_sets.size()) {
-            return nullptr;
+    template <typename Callback, typename... Components>
+    void with_smallest_primary(std::tuple<primary<Components>...>, Callback&& callback) {
+        if constexpr (sizeof...(Components) == 0) {
+            callback(primary<void>{});
+        } else {
+            size_type counts[] = {get_set<Components>().get_count()...};
+            auto smallest = std::min_element(std::begin(counts), std::end(counts)) - std::begin(counts);
+            auto i = std::ptrdiff_t{0};
+            ((i++ == smallest && (callback(primary<Components>{}), true)) || ...);
         }
-        return unsafe_get_com_set<Com>(guid);
     }
 
-    template <typename Com>
-    const component_set_impl<Com>* get_com_set(type_guid guid) const {
-        if (guid >= component_sets.size()) {
-            return nullptr;
+    /*! Visitor traits with the signature masks built at compile time.
+     */
+    template <typename... Params>
+    struct static_visitor_traits {
+        template <typename Param>
+        using tag_t = typename component_traits<database, Param>::category;
+
+        template <typename Param>
+        using com_t = typename component_traits<database, Param>::component;
+
+        struct signature_key {
+            signature_type required;
+            signature_type denied;
+        };
+
+        template <typename Param>
+        static constexpr void add_to_key(signature_key& key) {
+            if constexpr (std::is_same_v<tag_t<Param>, component_tags::inverted>) {
+                key.denied.set(bit_of<com_t<Param>>());
+            } else if constexpr (std::is_base_of_v<component_tags::positive, tag_t<Param>>) {
+                key.required.set(bit_of<com_t<Param>>());
+            }
         }
-        return unsafe_get_com_set<Com>(guid);
-    }
 
-    template <typename Com>
-    component_set_impl<Com>* unsafe_get_com_set(type_guid guid) {
-        auto& com_set = component_sets[guid];
-        auto com_set_impl = static_cast<component_set_impl<Com>*>(com_set.get());
-        return com_set_impl;
-    }
+        static constexpr signature_key make_key() {
+            auto key = signature_key{};
+            key.required.set(0);
+            (add_to_key<Params>(key), ...);
+            return key;
+        }
 
-    template <typename Com>
-    const component_set_impl<Com>* unsafe_get_com_set(type_guid guid) const {
-        auto& com_set = component_sets[guid];
-        auto com_set_impl = static_cast<const component_set_impl<Com>*>(com_set.get());
-        return com_set_impl;
-    }
+        static constexpr signature_key key = make_key();
 
-    template <typename Com>
-    component_set_impl<Com>& get_or_create_com_set() {
-        auto guid = get_type_guid<Com>();
-        if (component_sets.size() <= guid) {
-            component_sets.resize(guid + 1);
+        template <typename Visitor, typename Component>
+        static void visit(static_database& db, Visitor& visitor, primary<Component>) {
+            auto& com_set = db.get_set<Component>();
+            com_set.for_each_valid(0, com_set.capacity(), [&](size_type cid) {
+                apply(db, visitor, com_set.get_entid(cid));
+            });
         }
-        auto& com_set = component_sets[guid];
-        if (!com_set) {
-            com_set = std::make_unique<component_set_impl<Com>>();
+
+        template <typename Visitor>
+        static void visit(static_database& db, Visitor& visitor, primary<void>) {
+            for (auto i = size_type{0}; i < db.signatures.size(); ++i) {
+                apply(db, visitor, i);
+            }
         }
-        auto com_set_impl = static_cast<component_set_impl<Com>*>(com_set.get());
-        return *com_set_impl;
-    }
 
-    template <typename Visitor, typename Component>
-    void visit_helper(Visitor&& visitor, primary<Component>) {
-        using db_traits = database_traits<database>;
-        using visitor_traits = typename db_traits::visitor_traits<Visitor>;
+        template <typename Visitor>
+        static void apply(static_database& db, Visitor& visitor, size_type entid) {
+            const auto& sig = db.signatures[entid];
+            if (sig.contains_all(key.required) && !sig.intersects(key.denied)) {
+                visitor(get_com<Params>(tag_t<Params>{}, db, entid)...);
+            }
+        }
 
-        auto traits = visitor_traits{};
+        template <typename Com>
+        static Com& get_com(component_tags::normal, static_database& db, size_type entid) {
+            static_assert(!is_field_split_v<Com>, "Field-split components must be visited as soa_ref<T>");
+            auto& com_set = db.get_set<Com>();
+            return com_set.get_com(com_set.get_comid(entid));
+        }
 
-        if (auto com_set_ptr = get_com_set<Component>(traits.template get_guid<Component>())) {
-            auto& com_set = *com_set_ptr;
+        template <typename Com>
+        static Com get_com(component_tags::proxy, static_database& db, size_type entid) {
+            auto& com_set = db.get_set<com_t<Com>>();
+            return com_set.get_com(com_set.get_comid(entid));
+        }
 
-            for (com_id cid = 0, sz = com_set.capacity(); cid < sz; ++cid) {
-                if (com_set.is_valid(cid)) {
-                    auto i = com_set.get_entid(cid);
-                    traits.apply(*this, {i, entities[i].version}, cid, visitor);
+        template <typename Com>
+        static Com get_com(component_tags::optional, static_database& db, size_type entid) {
+            using inner_component = com_t<Com>;
+            auto present = db.signatures[entid].get(bit_of<inner_component>());
+            if constexpr (std::is_same_v<tag_t<inner_component>, component_tags::tagged>) {
+                return Com(present);
+            } else {
+                if (present) {
+                    auto& com_set = db.get_set<inner_component>();
+                    return Com(com_set.get_com(com_set.get_comid(entid)));
+                } else {
+                    return Com();
                 }
             }
         }
-    }
-
-    template <typename Visitor>
-    void visit_helper(Visitor&& visitor, primary<void>) {
-        using db_traits = database_traits<database>;
-        using visitor_traits = typename db_traits::visitor_traits<Visitor>;
 
-        auto traits = visitor_traits{};
+        template <typename Com>
+        static ent_id get_com(component_tags::eid, static_database& db, size_type entid) {
+            return {entid, db.versions[entid]};
+        }
 
-        for (auto i = 0u; i < entities.size(); ++i) {
-            if (entities[i].components.get(0)) {
-                traits.apply(*this, {i, entities[i].version}, {}, visitor);
-            }
+        template <typename Com>
+        static Com get_com(component_tags::unit, static_database&, size_type) {
+            return {};
         }
-    }
+    };
 
-    std::vector<entity> entities;
+    std::vector<signature_type> signatures;
+    std::vector<ent_id::version_type> versions;
     std::vector<ent_id::index_type> free_entities;
-    std::vector<std::unique_ptr<component_set>> component_sets;
+    std::tuple<com_set_t<Coms>...> sets;
 };
 
 } // namespace _detail
 
+using _detail::command_buffer;
+using _detail::query;
+using _detail::group;
+using _detail::thread_command_buffers;
+using _detail::basic_database;
 using _detail::database;
+using _detail::default_config;
+using _detail::compact_config;
+using _detail::archetype_database;
+using _detail::static_database;
 using _detail::require;
+using _detail::span;
+using _detail::soa_ref;
+using _detail::soa_span;
 using _detail::optional;
 using _detail::deny;
 using _detail::tag;
@@ -2,6 +2,8 @@
 
 #include <array>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "catch.hpp"
 
@@ -356,3 +358,256 @@ TEST_CASE("to_ptr and from_ptr work round-trip", "[ginseng]")
 
     REQUIRE(ent == ent2);
 }
+
+TEST_CASE("visit skips freed component slots", "[ginseng]")
+{
+    DB db;
+
+    struct Data { int id; };
+
+    std::vector<ent_id> eids;
+
+    for (int i = 0; i < 200; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, Data{i});
+        eids.push_back(ent);
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        if (i % 5 != 0) {
+            db.remove_component<Data>(eids[i]);
+        }
+    }
+
+    std::vector<int> visited;
+    db.visit([&](Data& data) {
+        visited.push_back(data.id);
+        // Removing a component that has not been visited yet must prevent it from being visited.
+        if (data.id + 5 < 200) {
+            db.remove_component<Data>(eids[data.id + 5]);
+        }
+    });
+
+    REQUIRE((visited == std::vector<int>{0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 100, 110, 120, 130, 140, 150, 160, 170, 180, 190}));
+}
+
+template <int N>
+struct ManyCom {
+    int value;
+};
+
+template <int... Ns>
+void add_many_coms(DB& db, ent_id ent, std::integer_sequence<int, Ns...>) {
+    (db.add_component(ent, ManyCom<Ns>{Ns}), ...);
+}
+
+TEST_CASE("visitors match signatures spanning several words", "[ginseng]")
+{
+    DB db;
+
+    auto all = db.create_entity();
+    add_many_coms(db, all, std::make_integer_sequence<int, 140>{});
+
+    auto some = db.create_entity();
+    db.add_component(some, ManyCom<1>{1});
+    db.add_component(some, ManyCom<139>{139});
+
+    auto visited = 0;
+    db.visit([&](ManyCom<1>&, ManyCom<139>& last) {
+        REQUIRE(last.value == 139);
+        ++visited;
+    });
+    REQUIRE(visited == 2);
+
+    visited = 0;
+    db.visit([&](ent_id eid, ManyCom<1>&, deny<ManyCom<138>>) {
+        REQUIRE(eid == some);
+        ++visited;
+    });
+    REQUIRE(visited == 1);
+
+    visited = 0;
+    db.visit([&](ent_id eid, ginseng::require<ManyCom<70>>, optional<ManyCom<2>> two) {
+        REQUIRE(eid == all);
+        REQUIRE(two->value == 2);
+        ++visited;
+    });
+    REQUIRE(visited == 1);
+}
+
+TEST_CASE("high component bits are cleared when entities are destroyed", "[ginseng]")
+{
+    DB db;
+
+    auto first = db.create_entity();
+    add_many_coms(db, first, std::make_integer_sequence<int, 140>{});
+
+    auto second = db.create_entity();
+    db.add_component(second, ManyCom<100>{100});
+    db.remove_component<ManyCom<100>>(second);
+    REQUIRE(!db.has_component<ManyCom<100>>(second));
+
+    db.destroy_entity(first);
+
+    auto reused = db.create_entity();
+    REQUIRE(reused.get_index() == first.get_index());
+    REQUIRE(!db.has_component<ManyCom<139>>(reused));
+
+    db.add_component(reused, ManyCom<120>{120});
+    db.add_component(second, ManyCom<130>{130});
+
+    auto visited = 0;
+    db.visit([&](ent_id eid, ManyCom<120>& com, deny<ManyCom<130>>) {
+        REQUIRE(eid == reused);
+        REQUIRE(com.value == 120);
+        ++visited;
+    });
+    REQUIRE(visited == 1);
+    REQUIRE(db.count<ManyCom<139>>() == 0);
+}
+
+TEST_CASE("databases only track the component types they use", "[ginseng]")
+{
+    DB big;
+    add_many_coms(big, big.create_entity(), std::make_integer_sequence<int, 150>{});
+
+    DB db;
+
+    auto ent = db.create_entity();
+    db.add_component(ent, ManyCom<149>{149});
+
+    REQUIRE(db.has_component<ManyCom<149>>(ent));
+    REQUIRE(!db.has_component<ManyCom<148>>(ent));
+    REQUIRE(db.get_component<ManyCom<147>*>(ent) == nullptr);
+
+    auto visited = 0;
+    db.visit([&](ent_id, ginseng::require<ManyCom<148>>) { ++visited; });
+    db.visit([&](ent_id, ginseng::tag<ManyCom<146>>) { ++visited; });
+    REQUIRE(visited == 0);
+
+    db.visit([&](ManyCom<149>& com, deny<ManyCom<148>>, optional<ManyCom<147>> other) {
+        REQUIRE(com.value == 149);
+        REQUIRE(!other);
+        ++visited;
+    });
+    REQUIRE(visited == 1);
+
+    auto& q = db.get_query<ManyCom<149>, ManyCom<145>>();
+    REQUIRE(q.size() == 0);
+
+    db.add_component(ent, ManyCom<145>{145});
+    REQUIRE(q.size() == 1);
+}
+
+TEST_CASE("types first added during a visit are seen by the rest of it", "[ginseng]")
+{
+    struct A {};
+    struct Done {};
+    struct Extra {};
+
+    DB db;
+
+    std::vector<ent_id> all;
+    for (int i = 0; i < 4; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, A{});
+        all.push_back(ent);
+    }
+
+    auto visited = 0;
+    db.visit([&](ent_id, A&, deny<ginseng::tag<Done>>) {
+        ++visited;
+        for (auto e : all) {
+            db.add_component(e, ginseng::tag<Done>{});
+        }
+    });
+    REQUIRE(visited == 1);
+
+    auto seen = 0;
+    db.visit([&](ent_id, A&, optional<Extra> extra) {
+        if (extra) {
+            ++seen;
+        }
+        for (auto e : all) {
+            db.add_component(e, Extra{});
+        }
+    });
+    REQUIRE(seen == 3);
+}
+
+TEST_CASE("registered component types are ready before first use", "[ginseng]")
+{
+    DB db;
+
+    auto ent = db.create_entity();
+
+    // Slots 1 through 127 fill the first two signature words.
+    add_many_coms(db, ent, std::make_integer_sequence<int, 127>{});
+    REQUIRE(db.signature_words() == 2);
+
+    db.register_component<ManyCom<140>>();
+    REQUIRE(db.signature_words() == 3);
+    db.register_component<ginseng::tag<ManyCom<141>>>();
+    db.register_component<ManyCom<140>>();
+    REQUIRE(db.signature_words() == 3);
+    REQUIRE(db.count<ManyCom<140>>() == 0);
+    REQUIRE(!db.has_component<ManyCom<140>>(ent));
+
+    db.add_component(ent, ManyCom<140>{140});
+    db.add_component(ent, ginseng::tag<ManyCom<141>>{});
+    REQUIRE(db.signature_words() == 3);
+
+    auto visited = 0;
+    db.visit([&](ManyCom<140>& com, ManyCom<126>&, ginseng::tag<ManyCom<141>>) {
+        REQUIRE(com.value == 140);
+        ++visited;
+    });
+    REQUIRE(visited == 1);
+}
+
+TEST_CASE("destroy_entities destroys every listed entity once", "[ginseng]")
+{
+    DB db;
+
+    struct Data { int id; };
+    struct Other { std::unique_ptr<int> value; };
+    struct Marker {};
+
+    std::vector<ent_id> eids;
+
+    for (int i = 0; i < 100; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, Data{i});
+        if (i % 2 == 0) {
+            db.add_component(ent, Other{std::make_unique<int>(i)});
+        }
+        if (i % 3 == 0) {
+            db.add_component(ent, ginseng::tag<Marker>{});
+        }
+        eids.push_back(ent);
+    }
+
+    std::vector<ent_id> doomed;
+    for (int i = 0; i < 100; i += 4) {
+        doomed.push_back(eids[i]);
+    }
+    doomed.push_back(eids[0]);
+
+    db.destroy_entity(eids[8]);
+    db.destroy_entities(doomed.begin(), doomed.end());
+
+    REQUIRE(db.size() == 75);
+    REQUIRE(db.count<Data>() == 75);
+    REQUIRE(db.count<Other>() == 25);
+
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(db.exists(eids[i]) == (i % 4 != 0));
+    }
+
+    auto visited = 0;
+    db.visit([&](Data& data, ginseng::tag<Marker>) {
+        REQUIRE(data.id % 4 != 0);
+        ++visited;
+    });
+    REQUIRE(visited == 25);
+}
@@ -0,0 +1,215 @@
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "catch.hpp"
+
+using ADB = ginseng::archetype_database;
+using ginseng::deny;
+using ginseng::optional;
+using ginseng::require;
+using ginseng::tag;
+using ent_id = ADB::ent_id;
+
+namespace {
+
+struct APos {
+    int x;
+};
+
+struct AVel {
+    int dx;
+};
+
+struct ANamed {
+    std::unique_ptr<int> value;
+};
+
+struct alignas(32) AWide {
+    double d[4];
+};
+
+struct AMarked {};
+
+struct AThrowing {
+    AThrowing() = default;
+
+    AThrowing(AThrowing&&) {
+        throw 1;
+    }
+
+    AThrowing& operator=(AThrowing&&) = default;
+
+    std::unique_ptr<int> value = std::make_unique<int>(1);
+};
+
+} // namespace
+
+TEST_CASE("archetype databases add and remove components", "[archetype]")
+{
+    ADB db;
+
+    auto ent = db.create_entity();
+    REQUIRE(db.exists(ent));
+    REQUIRE(db.size() == 1);
+    REQUIRE(db.num_archetypes() == 1);
+
+    db.add_component(ent, APos{7});
+    db.add_component(ent, AVel{3});
+    db.add_component(ent, ANamed{std::make_unique<int>(42)});
+    db.add_component(ent, tag<AMarked>{});
+
+    REQUIRE(db.get_component<APos>(ent).x == 7);
+    REQUIRE(db.get_component<AVel>(ent).dx == 3);
+    REQUIRE(*db.get_component<ANamed>(ent).value == 42);
+    REQUIRE(db.has_component<tag<AMarked>>(ent));
+
+    db.add_component(ent, APos{8});
+    REQUIRE(db.get_component<APos>(ent).x == 8);
+
+    db.remove_component<AVel>(ent);
+    REQUIRE(!db.has_component<AVel>(ent));
+    REQUIRE(db.get_component<AVel*>(ent) == nullptr);
+    REQUIRE(db.get_component<APos>(ent).x == 8);
+    REQUIRE(*db.get_component<ANamed>(ent).value == 42);
+
+    db.remove_component<tag<AMarked>>(ent);
+    REQUIRE(!db.has_component<tag<AMarked>>(ent));
+
+    db.destroy_entity(ent);
+    REQUIRE(!db.exists(ent));
+    REQUIRE(db.size() == 0);
+    REQUIRE(db.get_component<APos*>(ent) == nullptr);
+}
+
+TEST_CASE("archetype databases reuse transitions between archetypes", "[archetype]")
+{
+    ADB db;
+
+    for (int i = 0; i < 10; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, APos{i});
+        db.add_component(ent, AVel{i});
+        db.remove_component<APos>(ent);
+    }
+
+    // {}, {APos}, {APos, AVel}, {AVel}
+    REQUIRE(db.num_archetypes() == 4);
+    REQUIRE(db.count<AVel>() == 10);
+    REQUIRE(db.count<APos>() == 0);
+}
+
+TEST_CASE("archetype databases keep rows consistent across many chunks", "[archetype]")
+{
+    ADB db;
+
+    auto eids = std::vector<ent_id>{};
+    for (int i = 0; i < 5000; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, APos{i});
+        db.add_component(ent, AWide{{double(i), 0, 0, 0}});
+        if (i % 2 == 0) {
+            db.add_component(ent, AVel{i});
+        }
+        eids.push_back(ent);
+    }
+
+    for (int i = 0; i < 5000; i += 3) {
+        db.destroy_entity(eids[i]);
+    }
+
+    auto seen = 0;
+    db.visit([&](ent_id eid, const APos& pos, const AWide& wide) {
+        REQUIRE(reinterpret_cast<std::uintptr_t>(&wide) % alignof(AWide) == 0);
+        REQUIRE(pos.x % 3 != 0);
+        REQUIRE(wide.d[0] == pos.x);
+        REQUIRE(db.get_component<APos>(eid).x == pos.x);
+        ++seen;
+    });
+    REQUIRE(seen == 3333);
+}
+
+TEST_CASE("archetype databases accept the visitor grammar", "[archetype]")
+{
+    ADB db;
+
+    for (int i = 0; i < 12; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, APos{i});
+        if (i % 2 == 0) {
+            db.add_component(ent, AVel{1});
+        }
+        if (i % 3 == 0) {
+            db.add_component(ent, tag<AMarked>{});
+        }
+    }
+
+    auto count = 0;
+    db.visit([&](APos& pos, const AVel& vel) {
+        pos.x += vel.dx * 100;
+        ++count;
+    });
+    REQUIRE(count == 6);
+
+    count = 0;
+    db.visit([&](const APos& pos, require<AVel>, deny<tag<AMarked>>) {
+        REQUIRE(pos.x >= 100);
+        REQUIRE((pos.x - 100) % 3 != 0);
+        ++count;
+    });
+    REQUIRE(count == 4);
+
+    auto with_vel = 0;
+    auto marked = 0;
+    db.visit([&](ent_id eid, optional<AVel> vel, optional<tag<AMarked>> mark) {
+        REQUIRE(bool(vel) == db.has_component<AVel>(eid));
+        REQUIRE(bool(mark) == db.has_component<tag<AMarked>>(eid));
+        with_vel += bool(vel);
+        marked += bool(mark);
+    });
+    REQUIRE(with_vel == 6);
+    REQUIRE(marked == 4);
+
+    count = 0;
+    db.visit([&](tag<AMarked>) { ++count; });
+    REQUIRE(count == 4);
+
+    db.visit([&](ent_id eid, tag<AMarked>) { db.destroy_entity(eid); });
+    REQUIRE(db.size() == 8);
+    REQUIRE(db.count<tag<AMarked>>() == 0);
+}
+
+TEST_CASE("archetype databases keep the entity in place when a new component throws", "[archetype]")
+{
+    ADB db;
+
+    auto ent = db.create_entity();
+    db.add_component(ent, ANamed{std::make_unique<int>(7)});
+    db.add_component(ent, APos{3});
+
+    auto thrown = false;
+    try {
+        db.add_component(ent, AThrowing{});
+    } catch (int) {
+        thrown = true;
+    }
+
+    REQUIRE(thrown);
+    REQUIRE(!db.has_component<AThrowing>(ent));
+    REQUIRE(*db.get_component<ANamed>(ent).value == 7);
+    REQUIRE(db.get_component<APos>(ent).x == 3);
+
+    auto visited = 0;
+    db.visit([&](ent_id, const ANamed& named, optional<AThrowing> thrower) {
+        REQUIRE(*named.value == 7);
+        REQUIRE(!thrower);
+        ++visited;
+    });
+    REQUIRE(visited == 1);
+
+    db.destroy_entity(ent);
+    REQUIRE(!db.exists(ent));
+}
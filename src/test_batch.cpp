@@ -0,0 +1,122 @@
+#include <ginseng/ginseng.hpp>
+
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "catch.hpp"
+
+using DB = ginseng::database;
+using ginseng::tag;
+using ent_id = DB::ent_id;
+
+TEST_CASE("create_entities creates the requested number of entities", "[ginseng]")
+{
+    DB db;
+
+    auto first = db.create_entity();
+    auto second = db.create_entity();
+    db.destroy_entity(first);
+
+    std::vector<ent_id> eids;
+    db.create_entities(5, std::back_inserter(eids));
+
+    REQUIRE(eids.size() == 5);
+    REQUIRE(db.size() == 6);
+    REQUIRE(db.exists(second));
+
+    for (auto& eid : eids) {
+        REQUIRE(db.exists(eid));
+    }
+
+    for (auto i = 0u; i < eids.size(); ++i) {
+        for (auto j = i + 1; j < eids.size(); ++j) {
+            REQUIRE(!(eids[i] == eids[j]));
+        }
+    }
+}
+
+TEST_CASE("create_entities_with adds the generated components", "[ginseng]")
+{
+    DB db;
+
+    struct Position { int x; };
+    struct Name { std::string name; };
+    struct Marker {};
+
+    auto old = db.create_entity();
+    db.add_component(old, Position{-1});
+    db.destroy_entity(old);
+
+    auto next = 0;
+    std::vector<ent_id> eids;
+    db.create_entities_with<Position, Name, tag<Marker>>(1000, [&](ent_id eid) {
+        eids.push_back(eid);
+        auto i = next++;
+        return std::make_tuple(Position{i}, Name{std::to_string(i)}, tag<Marker>{});
+    });
+
+    REQUIRE(db.size() == 1000);
+    REQUIRE(db.count<Position>() == 1000);
+    REQUIRE(db.count<Name>() == 1000);
+
+    for (auto i = 0; i < 1000; ++i) {
+        REQUIRE(db.get_component<Position>(eids[i]).x == i);
+        REQUIRE(db.get_component<Name>(eids[i]).name == std::to_string(i));
+        REQUIRE(db.has_component<tag<Marker>>(eids[i]));
+    }
+
+    auto visited = 0;
+    db.visit([&](const Position& pos, const Name& name, tag<Marker>) {
+        REQUIRE(std::to_string(pos.x) == name.name);
+        ++visited;
+    });
+    REQUIRE(visited == 1000);
+}
+
+TEST_CASE("create_entities_with destroys the entity whose generator throws", "[ginseng]")
+{
+    DB db;
+
+    struct Position { int x; };
+    struct Name { std::string name; };
+    struct Marker {};
+
+    auto next = 0;
+    std::vector<ent_id> eids;
+    auto thrown = false;
+
+    try {
+        db.create_entities_with<Position, Name, tag<Marker>>(3, [&](ent_id eid) {
+            eids.push_back(eid);
+            if (next == 1) {
+                throw next;
+            }
+            auto i = next++;
+            return std::make_tuple(Position{i}, Name{std::to_string(i)}, tag<Marker>{});
+        });
+    } catch (int) {
+        thrown = true;
+    }
+
+    REQUIRE(thrown);
+    REQUIRE(eids.size() == 2);
+    REQUIRE(db.size() == 1);
+    REQUIRE(db.exists(eids[0]));
+    REQUIRE(!db.exists(eids[1]));
+    REQUIRE(!db.has_component<Position>(eids[1]));
+    REQUIRE(db.count<Position>() == 1);
+    REQUIRE(db.count<Name>() == 1);
+
+    auto visited = 0;
+    db.visit([&](ent_id eid, const Position&, tag<Marker>) {
+        REQUIRE(eid == eids[0]);
+        ++visited;
+    });
+    REQUIRE(visited == 1);
+
+    db.destroy_entity(eids[0]);
+    REQUIRE(db.size() == 0);
+    REQUIRE(db.count<Name>() == 0);
+}
@@ -178,3 +178,75 @@ TEST_CASE("unsetting bits past the end does not disable sdo", "[dynamic_bitset]"
     db.unset(word_size + 10);
     REQUIRE(db.using_sdo() == true);
 }
+
+TEST_CASE("count returns the number of set bits", "[dynamic_bitset]") {
+    dynamic_bitset db;
+
+    REQUIRE(db.count() == 0);
+
+    db.set(0);
+    db.set(17);
+    db.set(word_size - 1);
+    REQUIRE(db.count() == 3);
+
+    db.set(word_size * 3 + 2);
+    REQUIRE(db.count() == 4);
+
+    db.unset(17);
+    REQUIRE(db.count() == 3);
+}
+
+TEST_CASE("find_next skips unset bits and words", "[dynamic_bitset]") {
+    dynamic_bitset db;
+
+    REQUIRE(db.find_next(0) == db.size());
+
+    db.set(3);
+    db.set(word_size * 2 + 5);
+    db.set(word_size * 2 + 6);
+
+    REQUIRE(db.find_next(0) == 3);
+    REQUIRE(db.find_next(3) == 3);
+    REQUIRE(db.find_next(4) == word_size * 2 + 5);
+    REQUIRE(db.find_next(word_size * 2 + 6) == word_size * 2 + 6);
+    REQUIRE(db.find_next(word_size * 2 + 7) == db.size());
+    REQUIRE(db.find_next(db.size() + 100) == db.size());
+}
+
+TEST_CASE("contains_all and intersects compare whole words", "[dynamic_bitset]") {
+    dynamic_bitset a;
+    dynamic_bitset b;
+
+    REQUIRE(a.contains_all(b));
+    REQUIRE(!a.intersects(b));
+
+    a.set(1);
+    a.set(word_size + 1);
+    b.set(1);
+
+    REQUIRE(a.contains_all(b));
+    REQUIRE(!b.contains_all(a));
+    REQUIRE(a.intersects(b));
+    REQUIRE(b.intersects(a));
+
+    b.set(word_size * 4);
+
+    REQUIRE(!a.contains_all(b));
+    REQUIRE(a.intersects(b));
+
+    b.unset(1);
+
+    REQUIRE(!a.intersects(b));
+}
+
+TEST_CASE("get_word returns zero past the end", "[dynamic_bitset]") {
+    dynamic_bitset db;
+
+    db.set(0);
+    db.set(word_size + 2);
+
+    REQUIRE(db.num_words() == 2);
+    REQUIRE(db.get_word(0) == 1);
+    REQUIRE(db.get_word(1) == 4);
+    REQUIRE(db.get_word(2) == 0);
+}
@@ -0,0 +1,174 @@
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "catch.hpp"
+
+using DB = ginseng::database;
+using ADB = ginseng::archetype_database;
+using ginseng::deny;
+using ginseng::require;
+using ginseng::span;
+using ginseng::tag;
+using ent_id = DB::ent_id;
+
+namespace {
+
+struct CPos {
+    double x;
+};
+
+struct CVel {
+    double dx;
+};
+
+struct CDensePos {
+    double x;
+};
+
+struct CDenseVel {
+    double dx;
+};
+
+struct CSkip {};
+
+} // namespace
+
+template <>
+struct ginseng::storage_traits<CDensePos> {
+    using policy = ginseng::storage_policy::dense;
+};
+
+template <>
+struct ginseng::storage_traits<CDenseVel> {
+    using policy = ginseng::storage_policy::dense;
+};
+
+TEST_CASE("visit_chunks visits runs of contiguous components", "[chunks]")
+{
+    DB db;
+
+    auto eids = std::vector<ent_id>{};
+    for (int i = 0; i < 40000; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, CPos{double(i)});
+        if (i % 10 == 0) {
+            db.add_component(ent, tag<CSkip>{});
+        }
+        eids.push_back(ent);
+    }
+    for (int i = 0; i < 40000; i += 7) {
+        db.destroy_entity(eids[i]);
+    }
+
+    auto runs = 0;
+    auto seen = std::size_t{0};
+    db.visit_chunks([&](span<CPos> pos, span<const ent_id> ids, deny<tag<CSkip>>) {
+        REQUIRE(pos.size() == ids.size());
+        REQUIRE(!pos.empty());
+        for (auto i = std::size_t{0}; i < pos.size(); ++i) {
+            REQUIRE(&db.get_component<CPos>(ids[i]) == &pos[i]);
+            REQUIRE(!db.has_component<tag<CSkip>>(ids[i]));
+        }
+        for (auto& p : pos) {
+            p.x = -p.x;
+        }
+        ++runs;
+        seen += pos.size();
+    });
+
+    auto expected = std::size_t{0};
+    db.visit([&](const CPos& pos, deny<tag<CSkip>>) {
+        REQUIRE(pos.x <= 0);
+        ++expected;
+    });
+
+    REQUIRE(seen == expected);
+    REQUIRE(runs > 1);
+}
+
+TEST_CASE("visit_chunks over a group loads every owned component", "[chunks]")
+{
+    DB db;
+
+    auto& g = db.get_group<CDensePos, CDenseVel>();
+
+    for (int i = 0; i < 40000; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, CDensePos{0});
+        if (i % 3 != 0) {
+            db.add_component(ent, CDenseVel{double(i)});
+        }
+    }
+
+    auto seen = std::size_t{0};
+    db.visit_chunks(g, [&](span<CDensePos> pos, span<const CDenseVel> vel, span<const ent_id> ids) {
+        REQUIRE(pos.size() == vel.size());
+        REQUIRE(pos.size() <= 32768);
+        for (auto i = std::size_t{0}; i < pos.size(); ++i) {
+            pos[i].x += vel[i].dx;
+            REQUIRE(db.get_component<CDenseVel>(ids[i]).dx == vel[i].dx);
+        }
+        seen += pos.size();
+    });
+
+    REQUIRE(seen == g.size());
+    db.visit([&](const CDensePos& pos, const CDenseVel& vel) { REQUIRE(pos.x == vel.dx); });
+}
+
+TEST_CASE("archetype visit_chunks visits every chunk of matching archetypes", "[chunks]")
+{
+    ADB db;
+
+    for (int i = 0; i < 3000; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, CPos{0});
+        db.add_component(ent, CVel{double(i)});
+        if (i % 2 == 0) {
+            db.add_component(ent, tag<CSkip>{});
+        }
+    }
+
+    auto seen = std::size_t{0};
+    db.visit_chunks([&](span<CPos> pos, span<const CVel> vel, span<const ent_id> ids, require<tag<CSkip>>) {
+        REQUIRE(pos.size() == vel.size());
+        REQUIRE(pos.size() == ids.size());
+        for (auto i = std::size_t{0}; i < pos.size(); ++i) {
+            pos[i].x = vel[i].dx;
+            REQUIRE(db.get_component<CVel>(ids[i]).dx == vel[i].dx);
+        }
+        seen += pos.size();
+    });
+
+    REQUIRE(seen == 1500);
+    db.visit([&](const CPos& pos, const CVel& vel, tag<CSkip>) { REQUIRE(pos.x == vel.dx); });
+    db.visit([&](const CPos& pos, deny<tag<CSkip>>) { REQUIRE(pos.x == 0); });
+}
+
+TEST_CASE("visit_chunks covers components smaller than a pointer", "[chunks]")
+{
+    DB db;
+
+    auto eids = std::vector<ent_id>{};
+    for (int i = 0; i < 1000; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, char(i % 100));
+        eids.push_back(ent);
+    }
+    for (int i = 0; i < 1000; i += 5) {
+        db.destroy_entity(eids[i]);
+    }
+    for (int i = 0; i < 100; ++i) {
+        db.add_component(db.create_entity(), char(-1));
+    }
+
+    auto seen = std::size_t{0};
+    db.visit_chunks([&](span<const char> flags, span<const ent_id> ids) {
+        for (auto i = std::size_t{0}; i < flags.size(); ++i) {
+            REQUIRE(static_cast<const void*>(&db.get_component<char>(ids[i])) == static_cast<const void*>(&flags[i]));
+        }
+        seen += flags.size();
+    });
+    REQUIRE(seen == 900);
+}
@@ -0,0 +1,219 @@
+#include <ginseng/ginseng.hpp>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "catch.hpp"
+
+using DB = ginseng::database;
+using ginseng::command_buffer;
+using ginseng::tag;
+using ent_id = DB::ent_id;
+
+TEST_CASE("command buffers defer structural changes made during a visit", "[commands]")
+{
+    DB db;
+
+    struct ID { int id; };
+    struct Spawned { int parent; };
+    struct Marker {};
+
+    for (int i = 0; i < 10; ++i) {
+        db.add_component(db.create_entity(), ID{i});
+    }
+
+    command_buffer commands;
+
+    auto visited = 0;
+    db.visit([&](ent_id eid, const ID& id) {
+        ++visited;
+        auto child = commands.create_entity();
+        commands.add_component(child, Spawned{id.id});
+        commands.add_component(child, ID{100 + id.id});
+        if (id.id % 2 == 0) {
+            commands.destroy_entity(eid);
+        } else {
+            commands.add_component(eid, tag<Marker>{});
+        }
+    });
+
+    REQUIRE(visited == 10);
+    REQUIRE(db.size() == 10);
+    REQUIRE(!commands.empty());
+
+    std::vector<ent_id> created;
+    db.playback(commands, std::back_inserter(created));
+
+    REQUIRE(commands.empty());
+    REQUIRE(created.size() == 10);
+    REQUIRE(db.size() == 15);
+    REQUIRE(db.count<ID>() == 15);
+    REQUIRE(db.count<Spawned>() == 10);
+
+    for (int i = 0; i < 10; ++i) {
+        REQUIRE(db.get_component<Spawned>(created[i]).parent == i);
+        REQUIRE(db.get_component<ID>(created[i]).id == 100 + i);
+    }
+
+    auto marked = 0;
+    db.visit([&](const ID& id, tag<Marker>) {
+        REQUIRE(id.id % 2 == 1);
+        ++marked;
+    });
+    REQUIRE(marked == 5);
+}
+
+TEST_CASE("command buffers keep the order of commands for the same component type", "[commands]")
+{
+    DB db;
+
+    struct Data { int value; };
+    struct Other { std::unique_ptr<int> value; };
+
+    auto ent = db.create_entity();
+
+    command_buffer commands;
+    commands.add_component(ent, Data{1});
+    commands.add_component(ent, Other{std::make_unique<int>(7)});
+    commands.remove_component<Data>(ent);
+    commands.add_component(ent, Data{2});
+    commands.add_component(ent, Data{3});
+    commands.remove_component<Other>(ent);
+    commands.remove_component<Other>(ent);
+
+    db.playback(commands);
+
+    REQUIRE(db.get_component<Data>(ent).value == 3);
+    REQUIRE(!db.has_component<Other>(ent));
+}
+
+TEST_CASE("command buffers skip entities that no longer exist", "[commands]")
+{
+    DB db;
+
+    struct Data { int value; };
+
+    auto ent = db.create_entity();
+    auto gone = db.create_entity();
+    db.destroy_entity(gone);
+
+    command_buffer commands;
+    commands.add_component(gone, Data{1});
+    commands.add_component(ent, Data{2});
+    commands.destroy_entity(ent);
+    commands.destroy_entity(ent);
+
+    db.playback(commands);
+
+    REQUIRE(db.size() == 0);
+    REQUIRE(db.count<Data>() == 0);
+
+    commands.add_component(ent, Data{3});
+    commands.clear();
+    REQUIRE(commands.empty());
+}
+
+namespace {
+
+struct Health {
+    int value;
+};
+
+struct Corpse {
+    int value;
+};
+
+std::vector<ent_id::index_type> run_parallel_spawns() {
+    DB db;
+
+    for (int i = 0; i < 20000; ++i) {
+        db.add_component(db.create_entity(), Health{i % 7});
+    }
+
+    ginseng::thread_command_buffers commands;
+
+    db.par_visit([&](ent_id eid, const Health& health) {
+        auto& local = commands.local();
+        if (health.value == 0) {
+            auto corpse = local.create_entity();
+            local.add_component(corpse, Corpse{static_cast<int>(eid.get_index())});
+            local.destroy_entity(eid);
+        }
+    });
+
+    std::vector<ent_id> created;
+    db.playback(commands, std::back_inserter(created));
+
+    REQUIRE(commands.empty());
+
+    std::vector<ent_id::index_type> result;
+    for (auto& eid : created) {
+        result.push_back(eid.get_index());
+        result.push_back(static_cast<ent_id::index_type>(db.get_component<Corpse>(eid).value));
+    }
+
+    // Entities created after playback reuse the destroyed slots, so their order matters too.
+    for (int i = 0; i < 10; ++i) {
+        result.push_back(db.create_entity().get_index());
+    }
+
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("per-thread command buffers play back deterministically", "[commands]")
+{
+    auto first = run_parallel_spawns();
+
+    REQUIRE(first.size() == (20000 / 7 + 1) * 2 + 10);
+
+    for (int run = 0; run < 5; ++run) {
+        REQUIRE(run_parallel_spawns() == first);
+    }
+}
+
+TEST_CASE("per-thread command buffers keep several passes in order", "[commands]")
+{
+    DB db;
+
+    for (int i = 0; i < 20000; ++i) {
+        db.add_component(db.create_entity(), Health{i % 7});
+    }
+
+    ginseng::thread_command_buffers commands;
+
+    auto spawn_for = [&](int value) {
+        db.par_visit([&](ent_id eid, const Health& health) {
+            if (health.value == value) {
+                auto& local = commands.local();
+                local.add_component(local.create_entity(), Corpse{static_cast<int>(eid.get_index())});
+            }
+        });
+    };
+
+    spawn_for(0);
+    commands.local().add_component(commands.local().create_entity(), Corpse{-1});
+    spawn_for(1);
+
+    std::vector<ent_id> created;
+    db.playback(commands, std::back_inserter(created));
+
+    std::vector<int> expected;
+    for (int value : {0, 1}) {
+        for (int i = value; i < 20000; i += 7) {
+            expected.push_back(i);
+        }
+        if (value == 0) {
+            expected.push_back(-1);
+        }
+    }
+
+    std::vector<int> values;
+    for (auto& eid : created) {
+        values.push_back(db.get_component<Corpse>(eid).value);
+    }
+
+    REQUIRE(values == expected);
+}
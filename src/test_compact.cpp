@@ -0,0 +1,91 @@
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "catch.hpp"
+
+using DB = ginseng::database;
+using ginseng::tag;
+using ent_id = DB::ent_id;
+
+TEST_CASE("compact orders components by entity and keeps their values", "[ginseng]")
+{
+    DB db;
+
+    struct ID { int id; };
+    struct Owned { std::unique_ptr<int> value; };
+
+    std::vector<ent_id> eids;
+
+    for (int i = 0; i < 100; ++i) {
+        eids.push_back(db.create_entity());
+    }
+
+    // Add in reverse so that storage order is the opposite of entity order.
+    for (int i = 99; i >= 0; --i) {
+        db.add_component(eids[i], ID{i});
+        db.add_component(eids[i], Owned{std::make_unique<int>(i)});
+    }
+
+    for (int i = 0; i < 100; i += 3) {
+        db.remove_component<ID>(eids[i]);
+    }
+
+    db.compact<ID>();
+    db.compact_all();
+
+    REQUIRE(db.count<ID>() == 66);
+    REQUIRE(db.count<Owned>() == 100);
+
+    std::vector<ID*> ptrs;
+    std::vector<int> ids;
+    db.visit([&](ID& id) {
+        ptrs.push_back(&id);
+        ids.push_back(id.id);
+    });
+    // The first bucket holds 64 components, and the rest are in the second.
+    REQUIRE(ids.size() == 66);
+    REQUIRE(std::is_sorted(begin(ptrs), begin(ptrs) + 64));
+    REQUIRE(std::is_sorted(begin(ptrs) + 64, end(ptrs)));
+    REQUIRE(std::is_sorted(begin(ids), end(ids)));
+
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(*db.get_component<Owned>(eids[i]).value == i);
+        if (i % 3 == 0) {
+            REQUIRE(!db.has_component<ID>(eids[i]));
+        } else {
+            REQUIRE(db.get_component<ID>(eids[i]).id == i);
+        }
+    }
+
+    // The set keeps working after compaction.
+    db.add_component(eids[0], ID{0});
+    db.remove_component<ID>(eids[1]);
+    REQUIRE(db.count<ID>() == 66);
+    REQUIRE(db.get_component<ID>(eids[0]).id == 0);
+}
+
+TEST_CASE("compact handles empty sets and tags", "[ginseng]")
+{
+    DB db;
+
+    struct Data { int x; };
+    struct Marker {};
+
+    auto ent = db.create_entity();
+    db.add_component(ent, Data{1});
+    db.add_component(ent, tag<Marker>{});
+    db.remove_component<Data>(ent);
+
+    db.compact<Data>();
+    db.compact<tag<Marker>>();
+    db.compact_all();
+
+    REQUIRE(db.count<Data>() == 0);
+    REQUIRE(db.has_component<tag<Marker>>(ent));
+
+    db.add_component(ent, Data{2});
+    REQUIRE(db.get_component<Data>(ent).x == 2);
+}
@@ -0,0 +1,94 @@
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "catch.hpp"
+
+using DB = ginseng::basic_database<ginseng::compact_config>;
+using ginseng::deny;
+using ginseng::tag;
+using ent_id = DB::ent_id;
+
+namespace {
+
+struct Position { int x; };
+struct Velocity { int dx; };
+struct Frozen {};
+
+struct Target { ent_id eid; };
+
+} // namespace
+
+static_assert(sizeof(ent_id) == sizeof(std::uint64_t), "Compact entity IDs should be 64 bits");
+static_assert(std::is_same_v<ginseng::database, ginseng::basic_database<ginseng::default_config>>);
+
+TEST_CASE("compact databases store and visit components", "[config]")
+{
+    DB db;
+
+    std::vector<ent_id> eids;
+    db.create_entities(100, std::back_inserter(eids));
+
+    for (int i = 0; i < 100; ++i) {
+        db.add_component(eids[i], Position{i});
+        if (i % 2 == 0) {
+            db.add_component(eids[i], Velocity{1});
+        }
+        if (i % 4 == 0) {
+            db.add_component(eids[i], tag<Frozen>{});
+        }
+        db.add_component(eids[i], Target{eids[(i + 1) % 100]});
+    }
+
+    db.visit([](Position& pos, const Velocity& vel, deny<tag<Frozen>>) { pos.x += vel.dx; });
+
+    for (int i = 0; i < 100; ++i) {
+        auto expected = i % 2 == 0 && i % 4 != 0 ? i + 1 : i;
+        REQUIRE(db.get_component<Position>(eids[i]).x == expected);
+        REQUIRE(db.get_component<Target>(eids[i]).eid == eids[(i + 1) % 100]);
+    }
+
+    auto& q = db.get_query<Position, Velocity>();
+    REQUIRE(q.size() == 50);
+
+    db.destroy_entity(eids[0]);
+    REQUIRE(!db.exists(eids[0]));
+    REQUIRE(q.size() == 49);
+
+    auto fresh = db.create_entity();
+    REQUIRE(fresh.get_index() == eids[0].get_index());
+    REQUIRE(!(fresh == eids[0]));
+    REQUIRE(db.get_component<Position*>(eids[0]) == nullptr);
+    REQUIRE(db.from_ptr(db.to_ptr(fresh)) == fresh);
+}
+
+TEST_CASE("compact databases play back command buffers", "[config]")
+{
+    DB db;
+
+    for (int i = 0; i < 10; ++i) {
+        db.add_component(db.create_entity(), Position{i});
+    }
+
+    DB::command_buffer commands;
+
+    db.visit([&](ent_id eid, const Position& pos) {
+        auto child = commands.create_entity();
+        commands.add_component(child, Target{eid});
+        if (pos.x % 2 == 0) {
+            commands.remove_component<Position>(eid);
+        }
+    });
+
+    auto created = std::vector<ent_id>{};
+    db.playback(commands, std::back_inserter(created));
+
+    REQUIRE(created.size() == 10);
+    REQUIRE(db.count<Position>() == 5);
+    REQUIRE(std::all_of(created.begin(), created.end(), [&](ent_id eid) {
+        return db.exists(db.get_component<Target>(eid).eid);
+    }));
+}
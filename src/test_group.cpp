@@ -0,0 +1,134 @@
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "catch.hpp"
+
+using DB = ginseng::database;
+using ginseng::deny;
+using ginseng::tag;
+using ent_id = DB::ent_id;
+
+namespace {
+
+struct GPosition {
+    int x;
+};
+
+struct GVelocity {
+    int dx;
+};
+
+struct GMass {
+    int m;
+};
+
+struct Sleeping {};
+
+} // namespace
+
+template <>
+struct ginseng::storage_traits<GPosition> {
+    using policy = ginseng::storage_policy::dense;
+};
+
+template <>
+struct ginseng::storage_traits<GVelocity> {
+    using policy = ginseng::storage_policy::dense;
+};
+
+namespace {
+
+// Checks that the group's entities lead both sets, in the same order, and that no other entity qualifies.
+void check_packed(DB& db, ginseng::group<GPosition, GVelocity>& g, std::size_t expected) {
+    REQUIRE(g.size() == expected);
+
+    auto grouped = std::vector<int>{};
+    db.visit(g, [&](ent_id eid, const GPosition& pos, const GVelocity& vel) {
+        REQUIRE(db.get_component<GPosition>(eid).x == pos.x);
+        REQUIRE(db.get_component<GVelocity>(eid).dx == vel.dx);
+        REQUIRE(pos.x == vel.dx);
+        grouped.push_back(pos.x);
+    });
+
+    auto all = std::vector<int>{};
+    db.visit([&](const GPosition& pos, const GVelocity&) { all.push_back(pos.x); });
+
+    std::sort(grouped.begin(), grouped.end());
+    std::sort(all.begin(), all.end());
+    REQUIRE(grouped == all);
+}
+
+} // namespace
+
+TEST_CASE("owning groups pack entities that have every owned component", "[group]")
+{
+    DB db;
+
+    auto eids = std::vector<ent_id>{};
+    for (int i = 0; i < 20; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, GPosition{i});
+        if (i % 3 == 0) {
+            db.add_component(ent, GVelocity{i});
+        }
+        eids.push_back(ent);
+    }
+
+    auto& g = db.get_group<GPosition, GVelocity>();
+    REQUIRE((&g == &db.get_group<GPosition, GVelocity>()));
+    check_packed(db, g, 7);
+
+    db.add_component(eids[1], GVelocity{1});
+    db.add_component(eids[2], GVelocity{2});
+    check_packed(db, g, 9);
+
+    db.remove_component<GVelocity>(eids[0]);
+    db.remove_component<GPosition>(eids[3]);
+    check_packed(db, g, 7);
+
+    db.destroy_entity(eids[6]);
+    check_packed(db, g, 6);
+
+    auto doomed = std::vector<ent_id>{eids[9], eids[10], eids[12]};
+    db.destroy_entities(doomed.begin(), doomed.end());
+    check_packed(db, g, 4);
+
+    db.create_entities_with<GVelocity, GPosition>(5, [](ent_id) { return std::make_tuple(GVelocity{100}, GPosition{100}); });
+    check_packed(db, g, 9);
+
+    db.compact_all();
+    check_packed(db, g, 9);
+}
+
+TEST_CASE("owning group visitors can use other components and remove owned ones", "[group]")
+{
+    DB db;
+
+    auto& g = db.get_group<GPosition, GVelocity>();
+
+    for (int i = 0; i < 100; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, GPosition{i});
+        db.add_component(ent, GVelocity{i});
+        db.add_component(ent, GMass{i});
+        if (i % 4 == 0) {
+            db.add_component(ent, tag<Sleeping>{});
+        }
+    }
+
+    REQUIRE(g.size() == 100);
+
+    auto visited = 0;
+    db.visit(g, [&](ent_id eid, GPosition& pos, const GMass& mass, deny<tag<Sleeping>>) {
+        REQUIRE(pos.x == mass.m);
+        ++visited;
+        if (pos.x % 2 == 1) {
+            db.remove_component<GVelocity>(eid);
+        }
+    });
+
+    REQUIRE(visited == 75);
+    check_packed(db, g, 50);
+}
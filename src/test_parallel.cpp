@@ -0,0 +1,198 @@
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "catch.hpp"
+
+using DB = ginseng::database;
+using ginseng::deny;
+using ginseng::tag;
+using ent_id = DB::ent_id;
+
+TEST_CASE("par_visit visits every matching entity exactly once", "[ginseng]")
+{
+    DB db;
+
+    struct ID { int id; };
+    struct Data { int val; };
+
+    constexpr auto SZ = 100000;
+
+    for (int i = 0; i < SZ; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, ID{i});
+        if (i % 3 == 0) {
+            db.add_component(ent, Data{0});
+        }
+    }
+
+    std::vector<std::atomic<int>> visited(SZ);
+
+    db.par_visit([&](const ID& id) {
+        ++visited[id.id];
+    });
+
+    for (int i = 0; i < SZ; ++i) {
+        REQUIRE(visited[i] == 1);
+    }
+
+    db.par_visit([&](const ID& id, Data& data) {
+        data.val = id.id * 2;
+    });
+
+    auto count = 0;
+    db.visit([&](const ID& id, const Data& data) {
+        REQUIRE(data.val == id.id * 2);
+        ++count;
+    });
+    REQUIRE(count == (SZ + 2) / 3);
+
+    std::atomic<int> denied = 0;
+    db.par_visit([&](const ID&, deny<Data>) {
+        ++denied;
+    });
+    REQUIRE(denied == SZ - count);
+}
+
+TEST_CASE("par_visit without a primary component visits all entities", "[ginseng]")
+{
+    DB db;
+
+    struct Marker {};
+
+    constexpr auto SZ = 50000;
+
+    for (int i = 0; i < SZ; ++i) {
+        auto ent = db.create_entity();
+        if (i % 2 == 0) {
+            db.add_component(ent, tag<Marker>{});
+        }
+    }
+
+    std::atomic<int> all = 0;
+    db.par_visit([&](ent_id) {
+        ++all;
+    });
+    REQUIRE(all == SZ);
+
+    std::atomic<int> tagged = 0;
+    db.par_visit([&](tag<Marker>) {
+        ++tagged;
+    });
+    REQUIRE(tagged == SZ / 2);
+}
+
+TEST_CASE("par_visit on an empty database does nothing", "[ginseng]")
+{
+    DB db;
+
+    struct Data {};
+
+    auto visited = 0;
+    db.par_visit([&](Data&) { ++visited; });
+    db.par_visit([&](ent_id) { ++visited; });
+    REQUIRE(visited == 0);
+}
+
+template <int N>
+struct ThreadCom {};
+
+template <int... Ns>
+void get_thread_guids(std::vector<ginseng::_detail::type_guid>& guids, std::integer_sequence<int, Ns...>) {
+    guids = {ginseng::_detail::get_type_guid<ThreadCom<Ns>>()...};
+}
+
+TEST_CASE("type guids are unique when first used from several threads", "[ginseng]")
+{
+    constexpr auto num_threads = 8;
+
+    auto start = std::atomic<bool>{false};
+    auto guids = std::vector<std::vector<ginseng::_detail::type_guid>>(num_threads);
+    auto threads = std::vector<std::thread>{};
+
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            while (!start) {}
+            if (t % 2 == 0) {
+                get_thread_guids(guids[t], std::make_integer_sequence<int, 64>{});
+            } else {
+                get_thread_guids(guids[t], std::make_integer_sequence<int, 128>{});
+            }
+        });
+    }
+
+    start = true;
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto seen = guids[1];
+    std::sort(seen.begin(), seen.end());
+    REQUIRE(std::adjacent_find(seen.begin(), seen.end()) == seen.end());
+
+    for (auto& list : guids) {
+        REQUIRE(std::equal(list.begin(), list.end(), guids[1].begin()));
+    }
+}
+
+TEST_CASE("par_visit rethrows exceptions from the visitor", "[ginseng]")
+{
+    DB db;
+
+    struct Data { int val; };
+
+    for (int i = 0; i < 100000; ++i) {
+        db.add_component(db.create_entity(), Data{i});
+    }
+
+    auto thrown = false;
+    try {
+        db.par_visit([](const Data& data) {
+            if (data.val % 5000 == 4999) {
+                throw data.val;
+            }
+        });
+    } catch (int val) {
+        thrown = val % 5000 == 4999;
+    }
+    REQUIRE(thrown);
+
+    auto ent = db.create_entity();
+    db.add_component(ent, Data{-1});
+    REQUIRE(db.count<Data>() == 100001);
+
+    std::atomic<int> visited = 0;
+    db.par_visit([&](const Data&) { ++visited; });
+    REQUIRE(visited == 100001);
+}
+
+TEST_CASE("par_visit rejects a nested par_visit", "[ginseng]")
+{
+    DB db;
+
+    struct Data { int val; };
+
+    for (int i = 0; i < 100000; ++i) {
+        db.add_component(db.create_entity(), Data{i});
+    }
+
+    auto rejected = false;
+    try {
+        db.par_visit([&](const Data&) {
+            db.par_visit([](const Data&) {});
+        });
+    } catch (const std::logic_error&) {
+        rejected = true;
+    }
+    REQUIRE(rejected);
+
+    std::atomic<int> visited = 0;
+    db.par_visit([&](const Data&) { ++visited; });
+    REQUIRE(visited == 100000);
+}
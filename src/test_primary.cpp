@@ -67,3 +67,44 @@ TEST_CASE("Primary components are visited in cache-freindly order", "[ginseng]")
     REQUIRE(!std::is_sorted(begin(ptrs), end(ptrs)));
     REQUIRE(std::is_sorted(begin(dataptrs), end(dataptrs)));
 }
+
+TEST_CASE("The component with the fewest instances is used as the primary", "[ginseng]")
+{
+    DB db;
+
+    struct Transform { int id; };
+    struct Rare {};
+
+    std::vector<ent_id> eids;
+
+    for (int i = 0; i < 100; ++i) {
+        auto eid = db.create_entity();
+        db.add_component(eid, Transform{i});
+        eids.push_back(eid);
+    }
+
+    // Added in descending entity order, so the Rare set's storage order differs from Transform's.
+    db.add_component(eids[90], Rare{});
+    db.add_component(eids[50], Rare{});
+    db.add_component(eids[10], Rare{});
+
+    std::vector<int> visited;
+
+    db.visit([&](Transform& t, Rare&) { visited.push_back(t.id); });
+    REQUIRE((visited == std::vector<int>{90, 50, 10}));
+
+    visited.clear();
+    db.visit([&](Transform& t, ginseng::require<Rare>) { visited.push_back(t.id); });
+    REQUIRE((visited == std::vector<int>{90, 50, 10}));
+
+    visited.clear();
+    db.visit([&](Transform& t, deny<Rare>) { visited.push_back(t.id); });
+    REQUIRE(visited.size() == 97);
+    REQUIRE(std::is_sorted(begin(visited), end(visited)));
+
+    struct Missing {};
+
+    visited.clear();
+    db.visit([&](Transform& t, Missing&) { visited.push_back(t.id); });
+    REQUIRE(visited.empty());
+}
@@ -0,0 +1,213 @@
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "catch.hpp"
+
+using DB = ginseng::database;
+using ginseng::deny;
+using ginseng::optional;
+using ginseng::tag;
+using ent_id = DB::ent_id;
+
+namespace {
+
+struct Position { int x; };
+struct Velocity { int dx; };
+struct Frozen {};
+
+struct Packed {
+    int id;
+};
+
+std::vector<int> visit_positions(DB& db, ginseng::query<Position, Velocity, deny<tag<Frozen>>>& q) {
+    std::vector<int> xs;
+    db.visit(q, [&](const Position& pos, const Velocity&) { xs.push_back(pos.x); });
+    std::sort(xs.begin(), xs.end());
+    return xs;
+}
+
+} // namespace
+
+template <>
+struct ginseng::storage_traits<Packed> {
+    using policy = ginseng::storage_policy::dense;
+};
+
+TEST_CASE("cached queries track component changes", "[query]")
+{
+    DB db;
+
+    std::vector<ent_id> eids;
+    for (int i = 0; i < 6; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, Position{i});
+        eids.push_back(ent);
+    }
+    db.add_component(eids[1], Velocity{1});
+    db.add_component(eids[2], Velocity{1});
+
+    auto& q = db.get_query<Position, Velocity, deny<tag<Frozen>>>();
+    REQUIRE((&q == &db.get_query<Position, Velocity, deny<tag<Frozen>>>()));
+    REQUIRE(q.size() == 2);
+    REQUIRE((visit_positions(db, q) == std::vector<int>{1, 2}));
+
+    db.add_component(eids[3], Velocity{1});
+    db.add_component(eids[2], tag<Frozen>{});
+    REQUIRE((visit_positions(db, q) == std::vector<int>{1, 3}));
+
+    db.remove_component<tag<Frozen>>(eids[2]);
+    db.remove_component<Position>(eids[1]);
+    REQUIRE((visit_positions(db, q) == std::vector<int>{2, 3}));
+
+    db.destroy_entity(eids[3]);
+    REQUIRE((visit_positions(db, q) == std::vector<int>{2}));
+
+    auto fresh = db.create_entity();
+    REQUIRE(fresh.get_index() == eids[3].get_index());
+    REQUIRE(q.size() == 1);
+
+    db.create_entities_with<Position, Velocity>(3, [&](ent_id) { return std::make_tuple(Position{10}, Velocity{0}); });
+    REQUIRE(q.size() == 4);
+
+    std::vector<ent_id> doomed = {eids[2], eids[4]};
+    db.destroy_entities(doomed.begin(), doomed.end());
+    REQUIRE(q.size() == 3);
+}
+
+TEST_CASE("cached queries without required components track new entities", "[query]")
+{
+    DB db;
+
+    db.create_entity();
+    auto frozen = db.create_entity();
+    db.add_component(frozen, tag<Frozen>{});
+
+    auto& q = db.get_query<ent_id, deny<tag<Frozen>>>();
+    REQUIRE(q.size() == 1);
+
+    auto ent = db.create_entity();
+    REQUIRE(q.size() == 2);
+
+    db.add_component(ent, tag<Frozen>{});
+    REQUIRE(q.size() == 1);
+
+    db.destroy_entity(frozen);
+    db.destroy_entity(ent);
+    REQUIRE(q.size() == 1);
+}
+
+TEST_CASE("each database keeps its own cached queries", "[query]")
+{
+    DB first;
+    DB second;
+
+    for (auto db : {&first, &second}) {
+        auto ent = db->create_entity();
+        db->add_component(ent, Position{0});
+        db->add_component(db->create_entity(), Velocity{0});
+    }
+
+    // The databases create the same queries in opposite orders.
+    auto& first_pos = first.get_query<Position>();
+    auto& first_vel = first.get_query<Velocity>();
+    auto& second_vel = second.get_query<Velocity>();
+    auto& second_pos = second.get_query<Position>();
+
+    REQUIRE((&first_pos == &first.get_query<Position>()));
+    REQUIRE((&first_vel == &first.get_query<Velocity>()));
+    REQUIRE((&second_pos == &second.get_query<Position>()));
+    REQUIRE((&second_vel == &second.get_query<Velocity>()));
+    REQUIRE((&first_pos != &second_pos));
+
+    second.add_component(second.create_entity(), Position{1});
+    REQUIRE(first_pos.size() == 1);
+    REQUIRE(second_pos.size() == 2);
+    REQUIRE(second_vel.size() == 1);
+}
+
+TEST_CASE("cached queries can be changed while visiting", "[query]")
+{
+    DB db;
+
+    for (int i = 0; i < 100; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, Position{i});
+        db.add_component(ent, Velocity{i % 2});
+    }
+
+    auto& q = db.get_query<Position, Velocity>();
+
+    auto visited = 0;
+    db.visit(q, [&](ent_id eid, Position& pos, optional<Velocity> vel) {
+        ++visited;
+        if (vel->dx == 0) {
+            db.remove_component<Velocity>(eid);
+        } else {
+            pos.x = -1;
+        }
+    });
+
+    REQUIRE(visited == 100);
+    REQUIRE(q.size() == 50);
+
+    db.visit(q, [&](const Position& pos) { REQUIRE(pos.x == -1); });
+}
+
+TEST_CASE("cached queries follow components that move", "[query]")
+{
+    DB db;
+
+    auto& q = db.get_query<ent_id, Packed, deny<tag<Frozen>>>();
+
+    std::vector<ent_id> eids;
+    for (int i = 0; i < 40; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, Packed{i});
+        db.add_component(ent, tag<Frozen>{});
+        eids.push_back(ent);
+    }
+
+    // Thawing backwards puts the end of the dense set at the front of the query.
+    for (int i = 39; i >= 20; --i) {
+        db.remove_component<tag<Frozen>>(eids[i]);
+    }
+
+    auto check_ids = [&] {
+        auto visited = 0;
+        db.visit(q, [&](ent_id eid, const Packed& packed) {
+            ++visited;
+            REQUIRE(eids[packed.id] == eid);
+            REQUIRE(packed.id >= 20);
+        });
+        return visited;
+    };
+
+    REQUIRE(check_ids() == 20);
+
+    // Removing from the middle of a dense set moves the last component into the hole.
+    db.remove_component<Packed>(eids[20]);
+    db.destroy_entity(eids[21]);
+    REQUIRE(check_ids() == 18);
+
+    db.compact<Packed>();
+    REQUIRE(check_ids() == 18);
+
+    // Destroying entities outside the query moves the components of entities
+    // that have not been visited yet. Each one is still visited exactly once.
+    auto next_frozen = 0;
+    std::vector<int> seen;
+    db.visit(q, [&](ent_id eid, Packed& packed) {
+        REQUIRE(eids[packed.id] == eid);
+        REQUIRE(std::find(seen.begin(), seen.end(), packed.id) == seen.end());
+        seen.push_back(packed.id);
+        packed.id += 100;
+        db.destroy_entity(eids[next_frozen]);
+        ++next_frozen;
+    });
+    REQUIRE(seen.size() == 18);
+    for (auto id : seen) {
+        REQUIRE(db.get_component<Packed>(eids[id]).id == id + 100);
+    }
+}
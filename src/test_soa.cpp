@@ -0,0 +1,115 @@
+#include <ginseng/ginseng.hpp>
+
+#include <vector>
+
+#include "catch.hpp"
+
+using DB = ginseng::database;
+using ginseng::soa_ref;
+using ginseng::soa_span;
+using ginseng::span;
+using ent_id = DB::ent_id;
+
+namespace {
+
+struct Particle {
+    float x;
+    float y;
+    float vx;
+    float vy;
+    int age;
+};
+
+struct Emitter {
+    int rate;
+};
+
+} // namespace
+
+template <>
+struct ginseng::storage_traits<Particle> {
+    using policy = ginseng::storage_policy::soa<&Particle::x, &Particle::y, &Particle::vx, &Particle::vy, &Particle::age>;
+};
+
+TEST_CASE("field-split components round-trip through soa_ref", "[soa]")
+{
+    DB db;
+
+    auto ent = db.create_entity();
+    db.add_component(ent, Particle{1, 2, 3, 4, 5});
+
+    soa_ref<Particle> ref = db.get_component<Particle>(ent);
+    REQUIRE(ref.get<&Particle::x>() == 1);
+    REQUIRE(ref.get<&Particle::age>() == 5);
+
+    ref.get<&Particle::y>() = 20;
+    Particle copy = ref;
+    REQUIRE(copy.x == 1);
+    REQUIRE(copy.y == 20);
+    REQUIRE(copy.vy == 4);
+
+    db.add_component(ent, Particle{6, 7, 8, 9, 10});
+    REQUIRE(db.get_component<Particle>(ent).get<&Particle::vx>() == 8);
+
+    ref = Particle{0, 0, 0, 0, 1};
+    REQUIRE(db.get_component<Particle>(ent).get<&Particle::age>() == 1);
+}
+
+TEST_CASE("field-split components can be visited and removed", "[soa]")
+{
+    DB db;
+
+    auto eids = std::vector<ent_id>{};
+    for (int i = 0; i < 100; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, Particle{float(i), 0, 1, 2, i});
+        if (i % 4 == 0) {
+            db.add_component(ent, Emitter{i});
+        }
+        eids.push_back(ent);
+    }
+
+    for (int i = 0; i < 100; i += 3) {
+        db.destroy_entity(eids[i]);
+    }
+    db.compact<Particle>();
+
+    auto visited = 0;
+    db.visit([&](soa_ref<Particle> p) {
+        p.get<&Particle::x>() += p.get<&Particle::vx>();
+        ++visited;
+    });
+    REQUIRE(visited == 66);
+
+    visited = 0;
+    db.visit([&](ent_id eid, const Emitter& em, soa_ref<Particle> p) {
+        REQUIRE(p.get<&Particle::age>() == em.rate);
+        REQUIRE(p.get<&Particle::x>() == float(em.rate + 1));
+        REQUIRE(db.get_component<Particle>(eid).get<&Particle::age>() == em.rate);
+        ++visited;
+    });
+    REQUIRE(visited == 16);
+}
+
+TEST_CASE("field-split components expose per-field arrays to chunk visitors", "[soa]")
+{
+    DB db;
+
+    db.create_entities_with<Particle>(40000, [](ent_id eid) {
+        return std::make_tuple(Particle{0, 0, float(eid.get_index()), 1, 0});
+    });
+
+    auto seen = std::size_t{0};
+    db.visit_chunks([&](soa_span<Particle> ps, span<const ent_id> ids) {
+        auto x = ps.data<&Particle::x>();
+        auto vx = ps.data<&Particle::vx>();
+        for (auto i = std::size_t{0}; i < ps.size(); ++i) {
+            x[i] += vx[i];
+            REQUIRE(ps[i].get<&Particle::vx>() == float(ids[i].get_index()));
+        }
+        seen += ps.size();
+    });
+    REQUIRE(seen == 40000);
+
+    db.visit([](soa_ref<Particle> p) { REQUIRE(p.get<&Particle::x>() == p.get<&Particle::vx>()); });
+}
@@ -0,0 +1,223 @@
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "catch.hpp"
+
+using ginseng::deny;
+using ginseng::optional;
+using ginseng::require;
+using ginseng::tag;
+
+namespace {
+
+struct SPos {
+    int x;
+};
+
+struct SVel {
+    int dx;
+};
+
+struct SOwner {
+    std::unique_ptr<int> value;
+};
+
+struct SMarked {};
+
+struct SPoint {
+    float x, y;
+};
+
+} // namespace
+
+template <>
+struct ginseng::storage_traits<SVel> {
+    using policy = ginseng::storage_policy::dense;
+};
+
+template <>
+struct ginseng::storage_traits<SPoint> {
+    using policy = ginseng::storage_policy::soa<&SPoint::x, &SPoint::y>;
+};
+
+using SDB = ginseng::static_database<SPos, SVel, SOwner, tag<SMarked>, SPoint>;
+using ent_id = SDB::ent_id;
+
+static_assert(SDB::has_type<SPos>);
+static_assert(!SDB::has_type<int>);
+
+TEST_CASE("static databases add and remove components", "[static]")
+{
+    SDB db;
+
+    auto ent = db.create_entity();
+    REQUIRE(db.exists(ent));
+    REQUIRE(db.size() == 1);
+
+    db.add_component(ent, SPos{7});
+    db.add_component(ent, SOwner{std::make_unique<int>(42)});
+    db.add_component(ent, tag<SMarked>{});
+
+    REQUIRE(db.get_component<SPos>(ent).x == 7);
+    REQUIRE(*db.get_component<SOwner>(ent).value == 42);
+    REQUIRE(db.has_component<tag<SMarked>>(ent));
+    REQUIRE(db.get_component<SVel*>(ent) == nullptr);
+
+    db.add_component(ent, SPos{8});
+    REQUIRE(db.get_component<SPos>(ent).x == 8);
+    REQUIRE(db.count<SPos>() == 1);
+
+    db.remove_component<tag<SMarked>>(ent);
+    db.remove_component<SOwner>(ent);
+    REQUIRE(!db.has_component<tag<SMarked>>(ent));
+    REQUIRE(db.get_component<SOwner*>(ent) == nullptr);
+    REQUIRE(db.count<SOwner>() == 0);
+
+    db.destroy_entity(ent);
+    REQUIRE(!db.exists(ent));
+    REQUIRE(db.count<SPos>() == 0);
+
+    auto fresh = db.create_entity();
+    REQUIRE(fresh.get_index() == ent.get_index());
+    REQUIRE(!(fresh == ent));
+    REQUIRE(!db.has_component<SPos>(fresh));
+    REQUIRE(!db.has_component<SPos>(ent));
+}
+
+TEST_CASE("static databases visit with the usual parameters", "[static]")
+{
+    SDB db;
+
+    auto plain = db.create_entity();
+    auto moving = db.create_entity();
+    auto marked = db.create_entity();
+    db.add_component(plain, SPos{0});
+    db.add_component(moving, SPos{10});
+    db.add_component(moving, SVel{1});
+    db.add_component(marked, SPos{20});
+    db.add_component(marked, SVel{1});
+    db.add_component(marked, tag<SMarked>{});
+
+    db.visit([](SPos& pos, const SVel& vel, deny<tag<SMarked>>) { pos.x += vel.dx; });
+    REQUIRE(db.get_component<SPos>(plain).x == 0);
+    REQUIRE(db.get_component<SPos>(moving).x == 11);
+    REQUIRE(db.get_component<SPos>(marked).x == 20);
+
+    auto seen = std::vector<int>{};
+    db.visit([&](ent_id eid, require<SPos>, optional<SVel> vel, optional<tag<SMarked>> m) {
+        REQUIRE(db.exists(eid));
+        seen.push_back(eid.get_index() * 4 + (vel ? 2 : 0) + (m ? 1 : 0));
+    });
+    std::sort(seen.begin(), seen.end());
+    REQUIRE((seen == std::vector<int>{0, 4 + 2, 8 + 2 + 1}));
+}
+
+// Visitor masks are built from fixed_bitsets in constant expressions, including past the first word.
+constexpr auto make_mask() {
+    auto mask = ginseng::_detail::fixed_bitset<70>{};
+    mask.set(0);
+    mask.set(69);
+    return mask;
+}
+
+constexpr auto static_mask = make_mask();
+
+static_assert(static_mask.get(69) && !static_mask.get(68));
+static_assert(static_mask.contains_all(static_mask));
+static_assert(!ginseng::_detail::fixed_bitset<70>{}.contains_all(static_mask));
+static_assert(!ginseng::_detail::fixed_bitset<70>{}.intersects(static_mask));
+
+static_assert(std::is_nothrow_move_constructible_v<SDB>);
+static_assert(std::is_nothrow_move_assignable_v<SDB>);
+static_assert(!std::is_copy_constructible_v<SDB>);
+
+TEST_CASE("static databases move their component sets without moving components", "[static]")
+{
+    SDB db;
+
+    auto ent = db.create_entity();
+    db.add_component(ent, SPos{1});
+    db.add_component(ent, SVel{2});
+    db.add_component(ent, SOwner{std::make_unique<int>(3)});
+    db.add_component(ent, SPoint{4, 5});
+    db.add_component(ent, tag<SMarked>{});
+
+    auto pos = &db.get_component<SPos>(ent);
+    auto owned = db.get_component<SOwner>(ent).value.get();
+
+    SDB moved = std::move(db);
+    REQUIRE(&moved.get_component<SPos>(ent) == pos);
+    REQUIRE(moved.get_component<SOwner>(ent).value.get() == owned);
+    REQUIRE(moved.get_component<SVel>(ent).dx == 2);
+    REQUIRE(moved.get_component<SPoint>(ent).get<&SPoint::y>() == 5);
+    REQUIRE(moved.has_component<tag<SMarked>>(ent));
+    REQUIRE(moved.count<SPos>() == 1);
+
+    REQUIRE(db.size() == 0);
+    REQUIRE(db.count<SPos>() == 0);
+
+    auto other = db.create_entity();
+    db.add_component(other, SPos{6});
+    REQUIRE(db.count<SPos>() == 1);
+
+    db = std::move(moved);
+    REQUIRE(db.exists(ent));
+    REQUIRE(&db.get_component<SPos>(ent) == pos);
+    REQUIRE(db.count<SPos>() == 1);
+
+    auto visited = 0;
+    db.visit([&](ent_id eid, SPos& p, SVel& v, const SOwner& o, ginseng::soa_ref<SPoint>, tag<SMarked>) {
+        REQUIRE(eid == ent);
+        REQUIRE(p.x + v.dx + *o.value == 6);
+        ++visited;
+    });
+    REQUIRE(visited == 1);
+}
+
+TEST_CASE("static databases count tags from the signatures", "[static]")
+{
+    SDB db;
+
+    auto a = db.create_entity();
+    auto b = db.create_entity();
+    db.create_entity();
+
+    db.add_component(a, tag<SMarked>{});
+    db.add_component(a, tag<SMarked>{});
+    db.add_component(b, tag<SMarked>{});
+    REQUIRE(db.count<tag<SMarked>>() == 2);
+
+    db.remove_component<tag<SMarked>>(a);
+    REQUIRE(db.count<tag<SMarked>>() == 1);
+
+    // Destroying an entity clears its signature, so a recycled entity starts without the tag.
+    db.destroy_entity(b);
+    REQUIRE(db.count<tag<SMarked>>() == 0);
+
+    auto recycled = db.create_entity();
+    REQUIRE(recycled.get_index() == b.get_index());
+    REQUIRE(!db.has_component<tag<SMarked>>(recycled));
+    REQUIRE(db.count<tag<SMarked>>() == 0);
+}
+
+TEST_CASE("static databases store field-split components", "[static]")
+{
+    SDB db;
+
+    auto ent = db.create_entity();
+    db.add_component(ent, SPoint{1, 2});
+    db.add_component(db.create_entity(), SPos{0});
+
+    auto visited = 0;
+    db.visit([&](ginseng::soa_ref<SPoint> p) {
+        p.get<&SPoint::x>() += p.get<&SPoint::y>();
+        ++visited;
+    });
+
+    REQUIRE(visited == 1);
+    REQUIRE(db.get_component<SPoint>(ent).get<&SPoint::x>() == 3);
+}
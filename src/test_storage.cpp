@@ -0,0 +1,278 @@
+#include <ginseng/ginseng.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "catch.hpp"
+
+using DB = ginseng::database;
+using ent_id = DB::ent_id;
+
+struct DenseCom {
+    int id;
+};
+
+struct DenseOwner {
+    std::unique_ptr<int> value;
+};
+
+template <>
+struct ginseng::storage_traits<DenseCom> {
+    using policy = ginseng::storage_policy::dense;
+};
+
+template <>
+struct ginseng::storage_traits<DenseOwner> {
+    using policy = ginseng::storage_policy::dense;
+};
+
+struct SmallBuckets {
+    int id;
+};
+
+struct HugeCom {
+    char bytes[2048];
+    int id;
+};
+
+template <>
+struct ginseng::storage_traits<SmallBuckets> {
+    using policy = ginseng::storage_policy::stable;
+    static constexpr std::size_t bucket_size = 128;
+};
+
+TEST_CASE("dense components stay packed when removed", "[storage]")
+{
+    DB db;
+
+    std::vector<ent_id> eids;
+
+    for (int i = 0; i < 10; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, DenseCom{i});
+        db.add_component(ent, DenseOwner{std::make_unique<int>(i)});
+        eids.push_back(ent);
+    }
+
+    db.remove_component<DenseCom>(eids[2]);
+    db.remove_component<DenseOwner>(eids[2]);
+    db.destroy_entity(eids[5]);
+
+    REQUIRE(db.count<DenseCom>() == 8);
+    REQUIRE(db.count<DenseOwner>() == 8);
+
+    std::vector<DenseCom*> ptrs;
+    db.visit([&](DenseCom& com) { ptrs.push_back(&com); });
+    REQUIRE(ptrs.size() == 8);
+    REQUIRE(*std::max_element(begin(ptrs), end(ptrs)) - *std::min_element(begin(ptrs), end(ptrs)) == 7);
+
+    for (int i = 0; i < 10; ++i) {
+        if (i == 2 || i == 5) {
+            continue;
+        }
+        REQUIRE(db.get_component<DenseCom>(eids[i]).id == i);
+        REQUIRE(*db.get_component<DenseOwner>(eids[i]).value == i);
+    }
+}
+
+TEST_CASE("dense components can remove themselves during a visit", "[storage]")
+{
+    DB db;
+
+    for (int i = 0; i < 100; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, DenseCom{i});
+    }
+
+    std::vector<int> visited;
+    db.visit([&](ent_id eid, DenseCom& com) {
+        auto id = com.id;
+        visited.push_back(id);
+        if (id % 2 == 0) {
+            db.remove_component<DenseCom>(eid);
+        }
+        if (id == 50) {
+            db.add_component(db.create_entity(), DenseCom{1000});
+        }
+    });
+
+    std::sort(begin(visited), end(visited));
+    REQUIRE(visited.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(visited[i] == i);
+    }
+    REQUIRE(db.count<DenseCom>() == 51);
+}
+
+TEST_CASE("destroy_entities removes dense components in one pass", "[storage]")
+{
+    DB db;
+
+    std::vector<ent_id> eids;
+
+    for (int i = 0; i < 200; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, DenseCom{i});
+        db.add_component(ent, DenseOwner{std::make_unique<int>(i)});
+        eids.push_back(ent);
+    }
+
+    // Holes at the front and the back, so that some survivors move and some removed components are in the tail.
+    std::vector<ent_id> doomed;
+    for (int i = 0; i < 200; ++i) {
+        if (i % 3 == 0 || i >= 190) {
+            doomed.push_back(eids[i]);
+        }
+    }
+    db.destroy_entities(doomed.begin(), doomed.end());
+
+    REQUIRE(db.count<DenseCom>() == 126);
+    REQUIRE(db.count<DenseOwner>() == 126);
+
+    std::vector<int> visited;
+    db.visit([&](ent_id eid, DenseCom& com, const DenseOwner& owner) {
+        REQUIRE(eid == eids[com.id]);
+        REQUIRE(*owner.value == com.id);
+        visited.push_back(com.id);
+    });
+    std::sort(begin(visited), end(visited));
+    REQUIRE(visited.size() == 126);
+    REQUIRE(std::adjacent_find(begin(visited), end(visited)) == end(visited));
+    REQUIRE(std::none_of(begin(visited), end(visited), [](int id) { return id % 3 == 0 || id >= 190; }));
+}
+
+TEST_CASE("dense components can be compacted into entity order", "[storage]")
+{
+    DB db;
+
+    std::vector<ent_id> eids;
+
+    for (int i = 0; i < 50; ++i) {
+        eids.push_back(db.create_entity());
+    }
+
+    for (int i = 49; i >= 0; --i) {
+        db.add_component(eids[i], DenseCom{i});
+    }
+
+    db.remove_component<DenseCom>(eids[10]);
+    db.compact<DenseCom>();
+
+    std::vector<std::pair<DenseCom*, int>> visited;
+    db.visit([&](DenseCom& com) { visited.emplace_back(&com, com.id); });
+    std::sort(begin(visited), end(visited));
+
+    REQUIRE(visited.size() == 49);
+    REQUIRE(std::is_sorted(begin(visited), end(visited), [](auto& a, auto& b) { return a.second < b.second; }));
+}
+
+TEST_CASE("bucket layouts grow geometrically up to the bucket size", "[storage]")
+{
+    using layout = ginseng::_detail::bucket_layout<SmallBuckets>;
+
+    REQUIRE(layout::max_size == 128);
+    REQUIRE(ginseng::_detail::bucket_layout<HugeCom>::max_size == 64);
+    REQUIRE(ginseng::_detail::bucket_layout<int>::max_size == 4096 * 8);
+
+    REQUIRE(layout::bucket_capacity(0) == 64);
+    REQUIRE(layout::bucket_capacity(1) == 64);
+    REQUIRE(layout::bucket_capacity(2) == 128);
+    REQUIRE(layout::bucket_capacity(3) == 128);
+
+    using big_layout = ginseng::_detail::bucket_layout<int>;
+
+    for (auto i = std::size_t{0}; i < 200000; ++i) {
+        auto b = big_layout::bucket_index(i);
+        REQUIRE(big_layout::bucket_begin(b) + big_layout::relative_index(i) == i);
+        REQUIRE(big_layout::relative_index(i) < big_layout::bucket_capacity(b));
+    }
+
+    REQUIRE(big_layout::buckets_for(0) == 0);
+    REQUIRE(big_layout::buckets_for(64) == 1);
+    REQUIRE(big_layout::buckets_for(65) == 2);
+}
+
+TEST_CASE("components survive many small and large buckets", "[storage]")
+{
+    DB db;
+
+    auto eids = std::vector<ent_id>{};
+    for (int i = 0; i < 1000; ++i) {
+        auto ent = db.create_entity();
+        db.add_component(ent, SmallBuckets{i});
+        if (i % 10 == 0) {
+            auto huge = HugeCom{};
+            huge.id = i;
+            db.add_component(ent, std::move(huge));
+        }
+        eids.push_back(ent);
+    }
+
+    for (int i = 0; i < 1000; i += 3) {
+        db.destroy_entity(eids[i]);
+    }
+
+    auto count = 0;
+    db.visit([&](ent_id eid, const SmallBuckets& small) {
+        REQUIRE(eid.get_index() == eids[small.id].get_index());
+        ++count;
+    });
+    REQUIRE(count == 666);
+
+    db.compact_all();
+
+    count = 0;
+    db.visit([&](const SmallBuckets& small, const HugeCom& huge) {
+        REQUIRE(small.id == huge.id);
+        ++count;
+    });
+    REQUIRE(count == 66);
+}
+
+TEST_CASE("sparse indices only allocate the pages they use", "[storage]")
+{
+    using index = ginseng::_detail::sparse_index<>;
+
+    index idx;
+    REQUIRE(idx.get(0) == index::null_id);
+    REQUIRE(idx.get(9000000) == index::null_id);
+
+    idx.set(9000000, 7);
+    idx.set(3, 1);
+    REQUIRE(idx.get(9000000) == 7);
+    REQUIRE(idx.get(3) == 1);
+    REQUIRE(idx.get(9000001) == index::null_id);
+    REQUIRE(idx.get(5000000) == index::null_id);
+
+    idx.reserve(20000000);
+    REQUIRE(idx.get(19999999) == index::null_id);
+    REQUIRE(idx.get(9000000) == 7);
+
+    idx.truncate(4);
+    REQUIRE(idx.get(3) == 1);
+    REQUIRE(idx.get(9000000) == index::null_id);
+}
+
+TEST_CASE("rare components on high entity indices", "[storage]")
+{
+    DB db;
+
+    auto eids = std::vector<ent_id>{};
+    db.create_entities(200000, std::back_inserter(eids));
+
+    db.add_component(eids.back(), DenseCom{1});
+    db.add_component(eids.back(), SmallBuckets{2});
+    db.add_component(eids[5], SmallBuckets{3});
+
+    REQUIRE(db.get_component<DenseCom>(eids.back()).id == 1);
+    REQUIRE(db.get_component<SmallBuckets>(eids.back()).id == 2);
+    REQUIRE(db.get_component<SmallBuckets>(eids[5]).id == 3);
+    REQUIRE(db.get_component<DenseCom*>(eids[5]) == nullptr);
+
+    db.destroy_entity(eids.back());
+    db.compact_all();
+    REQUIRE(db.get_component<SmallBuckets>(eids[5]).id == 3);
+    REQUIRE(db.count<DenseCom>() == 0);
+}